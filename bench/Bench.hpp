@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "pico/stdlib.h"
+
+#if PICO_ON_DEVICE
+#include "hardware/clocks.h"
+#else
+#include <chrono>
+#include <string.h>
+#endif
+
+#define BENCH_ROUNDS 5              // best of, to filter out interrupts and scheduling
+#define BENCH_ROUND_NS 20000000     // each round lasts at least 20 ms
+#define BENCH_REPEAT_MS 10000       // on the target the suites rerun for late terminals
+
+/*
+ * Timing loop shared by the benchmarks. Every result is one JSON object per line:
+ *   {"bench":"drawLine/oct0","iterations":1024,"ns_per_op":81.2,...}
+ * followed by the fields of the benchmark. On the RP2040 the timer is read with time_us_64()
+ * and "cycles_per_op" is added from clk_sys. On the host a filter picks benchmarks by name.
+ */
+namespace bench {
+
+	inline const char * filter = nullptr;
+
+	inline uint64_t clockNs()
+	{
+#if PICO_ON_DEVICE
+		return time_us_64() * 1000;
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	template <typename Op>
+	uint64_t timeRound(Op &op, uint32_t iterations)
+	{
+		const uint64_t start = clockNs();
+		for(uint32_t i = 0; i < iterations; i++) op(i);
+		return clockNs() - start;
+	}
+
+	inline bool selected(const char * name)
+	{
+#if PICO_ON_DEVICE
+		return true;
+#else
+		return !filter || strstr(name, filter);
+#endif
+	}
+
+	struct result {
+		uint32_t iterations;
+		double ns_per_op;
+	};
+
+	/*
+	 * Run op(i) until a round takes BENCH_ROUND_NS, then keep the fastest of BENCH_ROUNDS rounds.
+	 */
+	template <typename Op>
+	result measure(Op op)
+	{
+		uint32_t iterations = 1;
+		uint64_t best = timeRound(op, iterations);
+
+		while(best < BENCH_ROUND_NS && iterations < (1u << 30))
+		{
+			iterations *= 2;
+			best = timeRound(op, iterations);
+		}
+
+		for(int round = 1; round < BENCH_ROUNDS; round++)
+		{
+			const uint64_t ns = timeRound(op, iterations);
+			if(ns < best) best = ns;
+		}
+
+		return {iterations, (double)best / iterations};
+	}
+
+	/*
+	 * Print one result, fields is a printf format for the benchmark's own "name":value pairs.
+	 */
+	inline void print(const char * name, const result &r, const char * fields, ...)
+	{
+		printf("{\"bench\":\"%s\",\"iterations\":%lu,\"ns_per_op\":%.1f,", name, (unsigned long)r.iterations, r.ns_per_op);
+#if PICO_ON_DEVICE
+		printf("\"cycles_per_op\":%.1f,", r.ns_per_op * clock_get_hz(clk_sys) / 1e9);
+#endif
+
+		va_list args;
+		va_start(args, fields);
+		vprintf(fields, args);
+		va_end(args);
+
+		printf("}\n");
+	}
+
+	/*
+	 * First line of a suite: where it ran.
+	 */
+	inline void header(const char * suite)
+	{
+#if PICO_ON_DEVICE
+		printf("{\"suite\":\"%s\",\"target\":\"rp2040\",\"clk_sys_hz\":%lu}\n", suite, (unsigned long)clock_get_hz(clk_sys));
+#else
+		printf("{\"suite\":\"%s\",\"target\":\"host\",\"compiler\":\"%s\"}\n", suite, __VERSION__);
+#endif
+	}
+
+};
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include <SampleCodec.hpp>
+#include <FlashLog.hpp>
+#include "Bench.hpp"
+
+#define TRACE_SAMPLES 4096
+#define TRACE_INTERVAL_MS 250
+#define RAW_SAMPLE_BYTES 8          // float temperature and a 32-bit timestamp
+
+/*
+ * SampleCodec benchmarks on synthetic traces, packed into blocks of one flash log record like
+ * the logger does. Every result also has "ns_per_sample", "bytes_per_sample" (block headers
+ * included) and "ratio" against RAW_SAMPLE_BYTES, see Bench.hpp for the format.
+ * Host: pico-logger-codec-bench [filter], runs the benchmarks whose name contains filter.
+ */
+
+namespace {
+
+	struct trace {
+		const char * name;
+		uint16_t codes[TRACE_SAMPLES];
+		bool faults[TRACE_SAMPLES];
+	};
+
+	// Encoded trace, one block after the other, each prefixed with its length
+	struct blocks {
+		uint8_t data[TRACE_SAMPLES * (SAMPLE_CODEC_MAX_SAMPLE + 1)];
+		size_t len;
+		size_t payload;     // block bytes without the length prefixes
+	};
+
+	uint32_t noise(uint32_t &state)
+	{
+		state = state * 1664525 + 1013904223;
+		return state >> 16;
+	}
+
+	// PT100 at about 21 C drifting by a few degrees over the trace, with a code of noise
+	void slowDrift(trace &t)
+	{
+		uint32_t state = 1;
+		t.name = "slowDrift";
+
+		for(int i = 0; i < TRACE_SAMPLES; i++)
+		{
+			t.codes[i] = 8260 + lroundf(250 * sinf(i / 600.0f)) + (int)(noise(state) % 3) - 1;
+			t.faults[i] = false;
+		}
+	}
+
+	// Level jumps of a few hundred codes every 256 samples, like a probe moved between baths,
+	// with a short fault burst of an open RTD at one of the changes
+	void stepChange(trace &t)
+	{
+		uint32_t state = 2;
+		t.name = "stepChange";
+		const uint16_t levels[] = {8260, 9100, 7400, 8800, 8261, 10200, 6900, 8000};
+
+		for(int i = 0; i < TRACE_SAMPLES; i++)
+		{
+			const bool open = i >= 2048 && i < 2052;
+			t.codes[i] = open ? 0x7FFF : levels[(i / 256) % 8] + (int)(noise(state) % 5) - 2;
+			t.faults[i] = open;
+		}
+	}
+
+	void encode(const trace &t, blocks &out)
+	{
+		uint8_t block[FLASH_LOG_MAX_RECORD];
+		SampleEncoder encoder(block, sizeof(block));
+
+		out.len = 0;
+		out.payload = 0;
+
+		auto emit = [&]() {
+			const size_t len = encoder.finish();
+			out.data[out.len++] = len;
+			memcpy(out.data + out.len, block, len);
+			out.len += len;
+			out.payload += len;
+		};
+
+		encoder.begin(0, TRACE_INTERVAL_MS);
+		for(int i = 0; i < TRACE_SAMPLES; i++)
+		{
+			if(!encoder.add(t.codes[i], t.faults[i]))
+			{
+				emit();
+				encoder.begin(i * TRACE_INTERVAL_MS * 1000, TRACE_INTERVAL_MS);
+				encoder.add(t.codes[i], t.faults[i]);
+			}
+		}
+		emit();
+	}
+
+	// Decodes every block, returns the number of samples that match the trace
+	uint32_t decode(const blocks &in, const trace &t)
+	{
+		uint32_t matching = 0;
+		uint32_t i = 0;
+
+		for(size_t pos = 0; pos < in.len; pos += 1 + in.data[pos])
+		{
+			SampleDecoder decoder(in.data + pos + 1, in.data[pos]);
+			uint64_t timestamp_us;
+			uint16_t code;
+			bool fault;
+
+			while(decoder.next(timestamp_us, code, fault))
+			{
+				if(i < TRACE_SAMPLES && code == t.codes[i] && fault == t.faults[i]
+					&& timestamp_us == i * TRACE_INTERVAL_MS * 1000) matching++;
+				i++;
+			}
+		}
+
+		return matching;
+	}
+
+	void run(const trace &t, blocks &encoded)
+	{
+		char name[32];
+
+		encode(t, encoded);
+		if(decode(encoded, t) != TRACE_SAMPLES)
+		{
+			printf("{\"error\":\"%s does not round trip\"}\n", t.name);
+			return;
+		}
+
+		const double bytes_per_sample = (double)encoded.payload / TRACE_SAMPLES;
+		const double ratio = RAW_SAMPLE_BYTES / bytes_per_sample;
+
+		snprintf(name, sizeof(name), "encode/%s", t.name);
+		if(bench::selected(name))
+		{
+			const bench::result r = bench::measure([&](uint32_t) { encode(t, encoded); });
+			bench::print(name, r, "\"ns_per_sample\":%.2f,\"bytes_per_sample\":%.3f,\"ratio\":%.2f",
+				r.ns_per_op / TRACE_SAMPLES, bytes_per_sample, ratio);
+		}
+
+		snprintf(name, sizeof(name), "decode/%s", t.name);
+		if(bench::selected(name))
+		{
+			volatile uint32_t sink;
+			const bench::result r = bench::measure([&](uint32_t) { sink = decode(encoded, t); });
+			(void) sink;
+			bench::print(name, r, "\"ns_per_sample\":%.2f,\"bytes_per_sample\":%.3f,\"ratio\":%.2f",
+				r.ns_per_op / TRACE_SAMPLES, bytes_per_sample, ratio);
+		}
+	}
+
+	void suite()
+	{
+		// Static, together well over what the RP2040 stacks hold
+		static trace t;
+		static blocks encoded;
+
+		bench::header("codec");
+
+		slowDrift(t);
+		run(t, encoded);
+
+		stepChange(t);
+		run(t, encoded);
+	}
+
+};
+
+
+int main(int argc, char * argv[]) {
+    stdio_init_all();
+
+#if PICO_ON_DEVICE
+    while(true)
+    {
+        suite();
+        sleep_ms(BENCH_REPEAT_MS);
+    }
+#else
+    if(argc > 1) bench::filter = argv[1];
+    suite();
+#endif
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "Sim.hpp"
+#include "SSD1306Model.hpp"
+#include <GFX.hpp>
+#include "Bench.hpp"
+
+/*
+ * Bus cost of SSD1306 frames on the simulated panel. Every result also has
+ * "wire_bytes_per_frame" (address bytes included), "transactions_per_frame" and
+ * "copied_bytes_per_frame", the pixel bytes that reached the bus from somewhere other than
+ * the framebuffer, i.e. went through a copy. ns_per_op is host time for the driver and the
+ * simulator, the wire time is simulated and not included.
+ * Host only: pico-logger-display-bench [filter], runs the benchmarks whose name contains filter.
+ */
+
+namespace {
+
+	// Gives the spy the framebuffer to check data pointers against
+	class Display : public GFX {
+		public:
+			using GFX::GFX;
+
+			const unsigned char * begin() const { return this->buffer; }
+			const unsigned char * end() const { return this->buffer + this->bufferlen; }
+	};
+
+	// The panel model, counting pixel bytes whose source is not the framebuffer
+	class CopySpy : public sim::I2CDevice {
+		SSD1306Model panel;
+
+		public:
+			const Display * oled = nullptr;
+			uint64_t copied = 0;
+
+			CopySpy() : panel(128, 32) {}
+
+			void write(const uint8_t * data, size_t len) override
+			{
+				this->panel.write(data, len);
+
+				// A data transaction is the 0x40 control byte and then the pixels
+				if(len < 2 || data[0] != 0x40) return;
+
+				const uint8_t * pixels = data + 1;
+				const bool inside = this->oled && pixels >= this->oled->begin() && pixels + (len - 1) <= this->oled->end();
+				if(!inside) this->copied += len - 1;
+			}
+	};
+
+	template <typename Op>
+	void run(const char * name, CopySpy &spy, Op op)
+	{
+		if(!bench::selected(name)) return;
+
+		const sim::bus_stats &i2c = sim::stats(i2c0);
+		const uint64_t bytes = i2c.bytes, transactions = i2c.transactions, copied = spy.copied;
+		uint64_t frames = 0;
+
+		const bench::result r = bench::measure([&](uint32_t i) {
+			op(i);
+			frames++;
+		});
+
+		bench::print(name, r, "\"wire_bytes_per_frame\":%.1f,\"transactions_per_frame\":%.2f,\"copied_bytes_per_frame\":%.1f",
+			(double)(i2c.bytes - bytes) / frames, (double)(i2c.transactions - transactions) / frames, (double)(spy.copied - copied) / frames);
+	}
+
+	void suite(Display &oled, CopySpy &spy)
+	{
+		const int w = oled.getWidth();
+		static unsigned char external[128 * 32 / 8];
+
+		bench::header("display");
+
+		run("display/full", spy, [&](uint32_t) {
+			oled.invalidate();
+			oled.display();
+		});
+
+		// The example's steady state, one changed readout
+		run("display/readout", spy, [&](uint32_t i) {
+			oled.drawFillRectangle(w - 30, 0, 30, 8, colors::BLACK);
+			oled.drawFixed(w - 30, 0, 200 + i % 100, 1, 5, align::RIGHT);
+			oled.display();
+		});
+
+		run("display/external", spy, [&](uint32_t i) {
+			external[i % sizeof(external)] ^= 1;
+			oled.display(external);
+		});
+
+		// The DMA front buffer holds one IC_DATA_CMD word per byte, filled from the framebuffer
+		run("flushAsync/full", spy, [&](uint32_t) {
+			oled.invalidate();
+			oled.flushAsync();
+			oled.waitFlush();
+		});
+	}
+
+};
+
+
+int main(int argc, char * argv[]) {
+    if(argc > 1) bench::filter = argv[1];
+
+    static CopySpy spy;
+    sim::attach(i2c0, 0x3C, &spy);
+    i2c_init(i2c0, 400 * 1000);
+
+    Display oled(0x3C, size::W128xH32, i2c0);
+    spy.oled = &oled;
+    oled.clear(colors::BLACK);
+    oled.drawString(0, 0, "Temperature :");
+
+    suite(oled, spy);
+    return 0;
+}
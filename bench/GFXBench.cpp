@@ -0,0 +1,209 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include <GFX.hpp>
+#include "Bench.hpp"
+
+/*
+ * Rendering benchmarks for GFX and SSD1306. Only the framebuffer work is measured, no bus transfers.
+ * Every result also has "pixels_per_s", see Bench.hpp for the format.
+ * The span kernels and the glyph blitter also run the per-pixel path they replaced, as <name>/perPixel,
+ * and report "speedup". drawChar/glyphs reports "glyphs_per_s" instead of "pixels_per_s".
+ * Host: pico-logger-bench [filter], runs the benchmarks whose name contains filter.
+ */
+
+namespace {
+
+	/*
+	 * pixels is the number of pixels one call of op writes.
+	 */
+	template <typename Op>
+	void run(const char * name, uint32_t pixels, Op op)
+	{
+		if(!bench::selected(name)) return;
+
+		const bench::result r = bench::measure(op);
+		bench::print(name, r, "\"pixels_per_s\":%.4g", pixels * 1e9 / r.ns_per_op);
+	}
+
+	/*
+	 * Run op and the per-pixel path it replaced as name/perPixel, op also reports "speedup".
+	 * unit is the rate field, count the number of units one call of either draws.
+	 */
+	template <typename Reference, typename Op>
+	void compare(const char * name, const char * unit, uint32_t count, Reference reference, Op op)
+	{
+		char reference_name[40];
+		snprintf(reference_name, sizeof(reference_name), "%s/perPixel", name);
+		if(!bench::selected(name) && !bench::selected(reference_name)) return;
+
+		const bench::result before = bench::measure(reference);
+		const bench::result after = bench::measure(op);
+
+		char fields[48];
+		snprintf(fields, sizeof(fields), "\"%s\":%%.4g", unit);
+		bench::print(reference_name, before, fields, count * 1e9 / before.ns_per_op);
+
+		snprintf(fields, sizeof(fields), "\"%s\":%%.4g,\"speedup\":%%.1f", unit);
+		bench::print(name, after, fields, count * 1e9 / after.ns_per_op, before.ns_per_op / after.ns_per_op);
+	}
+
+	// What drawFillRectangle() and the straight lines did before the span kernels, one drawPixel() each
+	void fillPerPixel(GFX &oled, int x, int y, int w, int h, colors color)
+	{
+		for(int py = y; py < y + h; py++)
+		{
+			for(int px = x; px < x + w; px++) oled.drawPixel(px, py, color);
+		}
+	}
+
+	// What drawChar() did before the page byte blitter, one drawPixel() per set bit
+	void charPerPixel(GFX &oled, const uint8_t * font, int x, int y, char chr, colors color)
+	{
+		const uint8_t * glyph = font + (chr - 0x20) * font[1] + 2;
+
+		for(uint8_t i = 0; i < font[1]; i++)
+		{
+			uint8_t line = glyph[i];
+			for(int8_t j = 0; j < font[0]; j++, line >>= 1)
+			{
+				if((line & 1) && x + i >= 0 && x + i < oled.getWidth() && y + j >= 0 && y + j < oled.getHeight())
+				{
+					oled.drawPixel(x + i, y + j, color);
+				}
+			}
+		}
+	}
+
+	int lineLength(int x0, int y0, int x1, int y1)
+	{
+		return 1 + (abs(x1 - x0) > abs(y1 - y0) ? abs(x1 - x0) : abs(y1 - y0));
+	}
+
+	void suite(GFX &oled)
+	{
+		const int w = oled.getWidth();
+		const int h = oled.getHeight();
+
+		bench::header("gfx");
+
+		run("drawPixel", 1, [&](uint32_t i) {
+			oled.drawPixel(i % w, (i / w) % h, colors::WHITE);
+		});
+
+		// One line from the centre into each octant, octant 0 is shallow to the right, counting clockwise
+		const int cx = w / 2, cy = h / 2;
+		const int ends[8][2] = {
+			{w - 1, cy + h / 4}, {cx + h / 4, h - 1}, {cx - h / 4, h - 1}, {0, cy + h / 4},
+			{0, cy - h / 4}, {cx - h / 4, 0}, {cx + h / 4, 0}, {w - 1, cy - h / 4},
+		};
+		for(int octant = 0; octant < 8; octant++)
+		{
+			char name[24];
+			snprintf(name, sizeof(name), "drawLine/oct%d", octant);
+			const int ex = ends[octant][0], ey = ends[octant][1];
+
+			run(name, lineLength(cx, cy, ex, ey), [&](uint32_t i) {
+				oled.drawLine(cx, cy, ex, ey, (i & 1) ? colors::BLACK : colors::WHITE);
+			});
+		}
+
+		run("drawChar", 8 * 5, [&](uint32_t i) {
+			oled.drawChar((i * 6) % (w - 5), ((i * 6) / (w - 5) * 8) % h, 'A' + i % 26);
+		});
+
+		// Blitter against the per-pixel glyph path, INVERSE at an unaligned y so every glyph straddles two pages
+		const uint8_t * font = oled.getFont();
+		compare("drawChar/glyphs", "glyphs_per_s", 1, [&](uint32_t i) {
+			charPerPixel(oled, font, (i * 6) % (w - 5), 3 + (i % 2) * 8, 'A' + i % 26, colors::INVERSE);
+		}, [&](uint32_t i) {
+			oled.drawChar((i * 6) % (w - 5), 3 + (i % 2) * 8, 'A' + i % 26, colors::INVERSE);
+		});
+
+		// Unaligned y, every glyph straddles two pages
+		run("drawString", 13 * 8 * 5, [&](uint32_t i) {
+			oled.drawString(i % 8, 3 + (i % 2) * 8, "Temperature :");
+		});
+
+		// Span kernels against per-pixel drawing, unaligned y so the rectangle covers partial pages
+		compare("drawFillRectangle", "pixels_per_s", 100 * 20, [&](uint32_t i) {
+			fillPerPixel(oled, 10, 5, 100, 20, (i & 1) ? colors::BLACK : colors::INVERSE);
+		}, [&](uint32_t i) {
+			oled.drawFillRectangle(10, 5, 100, 20, (i & 1) ? colors::BLACK : colors::INVERSE);
+		});
+
+		compare("drawHorizontalLine", "pixels_per_s", w, [&](uint32_t i) {
+			fillPerPixel(oled, 0, 3 + i % (h - 3), w, 1, colors::INVERSE);
+		}, [&](uint32_t i) {
+			oled.drawHorizontalLine(0, 3 + i % (h - 3), w, colors::INVERSE);
+		});
+
+		compare("drawVerticalLine", "pixels_per_s", h - 3, [&](uint32_t i) {
+			fillPerPixel(oled, i % w, 3, 1, h - 3, colors::INVERSE);
+		}, [&](uint32_t i) {
+			oled.drawVerticalLine(i % w, 3, h - 3, colors::INVERSE);
+		});
+
+		run("drawProgressBar", (w - 8) * 10, [&](uint32_t i) {
+			oled.drawProgressBar(4, 11, w - 8, 10, i % 101);
+		});
+
+		run("clear", w * h, [&](uint32_t i) {
+			oled.clear((i & 1) ? colors::WHITE : colors::BLACK);
+		});
+
+		// The whole example screen from scratch: labels, two readouts and a full strip chart
+		TrendGraph trend(&oled, 0, 17, w, h - 17);
+		for(int i = 0; i < w; i++) trend.push(21500 + (i * 37) % 900);
+
+		run("exampleScreen", w * h, [&](uint32_t i) {
+			oled.clear(colors::BLACK);
+			oled.drawString(0, 0, "Temperature :");
+			oled.drawString(0, 8, "Max 1h      :");
+			oled.drawFixed(w - 30, 0, 215 + i % 10, 1, 5, align::RIGHT);
+			oled.drawFixed(w - 30, 8, 224, 1, 5, align::RIGHT);
+			trend.redraw();
+		});
+	}
+
+	// The pixel path on a display with compile-time geometry, compare with drawPixel and drawLine/oct0
+	void fixedSuite(BasicGFX<SSD1306Fixed<128, 32>> &oled)
+	{
+		const int w = oled.getWidth();
+		const int h = oled.getHeight();
+
+		run("drawPixel/fixed", 1, [&](uint32_t i) {
+			oled.drawPixel(i % w, (i / w) % h, colors::WHITE);
+		});
+
+		run("drawLine/oct0/fixed", lineLength(w / 2, h / 2, w - 1, h / 2 + h / 4), [&](uint32_t i) {
+			oled.drawLine(w / 2, h / 2, w - 1, h / 2 + h / 4, (i & 1) ? colors::BLACK : colors::WHITE);
+		});
+	}
+
+};
+
+
+int main(int argc, char * argv[]) {
+    stdio_init_all();
+
+    // The panel does not need to be connected, nothing is flushed
+    i2c_init(i2c0, 400 * 1000);
+    GFX oled(0x3C, size::W128xH32, i2c0);
+    static BasicGFX<SSD1306Fixed<128, 32>> fixed(0x3C, i2c0);   // framebuffer inside, keep it off the stack
+
+#if PICO_ON_DEVICE
+    while(true)
+    {
+        suite(oled);
+        fixedSuite(fixed);
+        sleep_ms(BENCH_REPEAT_MS);
+    }
+#else
+    if(argc > 1) bench::filter = argv[1];
+    suite(oled);
+    fixedSuite(fixed);
+#endif
+    return 0;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include <MAX31865.hpp>
+#include <RTDTable.hpp>
+#include "Bench.hpp"
+
+/*
+ * RTD code to temperature, RTDTable against MAX31865::calculateTemperature(). The codes walk
+ * the whole 15-bit range so both the sqrt and the polynomial branch of the float path are hit.
+ * Every result also has "conversions_per_s", see Bench.hpp for the format.
+ * Build with PICO_LOGGER_PROFILE off, the float path carries a latency probe otherwise.
+ * Host: pico-logger-rtd-bench [filter], runs the benchmarks whose name contains filter.
+ */
+
+namespace {
+
+	// Spread consecutive iterations over the code range
+	inline uint16_t codeOf(uint32_t i)
+	{
+		return (i * 2053) & 0x7FFF;
+	}
+
+	template <typename Op>
+	void run(const char * name, Op op)
+	{
+		if(!bench::selected(name)) return;
+
+		const bench::result r = bench::measure(op);
+		bench::print(name, r, "\"conversions_per_s\":%.4g", 1e9 / r.ns_per_op);
+	}
+
+	template <uint32_t RTDnominal, uint32_t refResistor>
+	void suite(MAX31865 &rtd, const char * sensor)
+	{
+		typedef RTDTable<RTDnominal, refResistor> table;
+		char name[32];
+
+		volatile float float_sink;
+		snprintf(name, sizeof(name), "float/%s", sensor);
+		run(name, [&](uint32_t i) {
+			float_sink = rtd.calculateTemperature(codeOf(i), RTDnominal, refResistor);
+		});
+
+		volatile int32_t table_sink;
+		snprintf(name, sizeof(name), "table/%s", sensor);
+		run(name, [&](uint32_t i) {
+			table_sink = table::temperatureMilli(codeOf(i));
+		});
+
+		(void) float_sink;
+		(void) table_sink;
+	}
+
+};
+
+
+int main(int argc, char * argv[]) {
+    stdio_init_all();
+
+    // Only the conversion is measured, the chip does not need to be connected
+    spi_init(spi0, 500 * 1000);
+    MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+
+#if PICO_ON_DEVICE
+    while(true)
+    {
+        bench::header("rtd");
+        suite<100, 430>(rtd, "pt100");
+        suite<1000, 4300>(rtd, "pt1000");
+        sleep_ms(BENCH_REPEAT_MS);
+    }
+#else
+    if(argc > 1) bench::filter = argv[1];
+    bench::header("rtd");
+    suite<100, 430>(rtd, "pt100");
+    suite<1000, 4300>(rtd, "pt1000");
+#endif
+    return 0;
+}
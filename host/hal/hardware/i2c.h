@@ -0,0 +1,46 @@
+#pragma once
+
+#include "pico.h"
+
+#define I2C_IC_DATA_CMD_RESTART_BITS 0x00000400u
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200u
+#define I2C_IC_RAW_INTR_STAT_STOP_DET_BITS 0x00000200u
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x00000040u
+
+// The registers the drivers touch, data_cmd is fed by DMA
+typedef struct {
+	volatile uint32_t enable;
+	volatile uint32_t tar;
+	volatile uint32_t data_cmd;
+	volatile uint32_t raw_intr_stat;
+	volatile uint32_t clr_tx_abrt;
+	volatile uint32_t clr_stop_det;
+} i2c_hw_t;
+
+typedef struct i2c_inst {
+	i2c_hw_t *hw;
+	uint8_t index;
+} i2c_inst_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+uint i2c_init(i2c_inst_t *i2c, uint baudrate);
+void i2c_deinit(i2c_inst_t *i2c);
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+int i2c_read_blocking(i2c_inst_t *i2c, uint8_t addr, uint8_t *dst, size_t len, bool nostop);
+
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c) { return i2c->hw; }
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx) { return 32 + 2 * i2c->index + (is_tx ? 0 : 1); }
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "pico.h"
+
+// Interrupts only run where the firmware waits, see sim/Sim.hpp, so there is nothing to mask
+static inline uint32_t save_and_disable_interrupts(void)
+{
+	return 0;
+}
+
+static inline void restore_interrupts(uint32_t status)
+{
+	(void) status;
+}
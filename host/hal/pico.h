@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in for the Pico SDK, just the parts the drivers use. See host/sim/Sim.hpp.
+
+// Same switch as the SDK's host build, code only meant for the RP2040 checks it
+#define PICO_ON_DEVICE 0
+
+#include "pico/types.h"
+#include "pico/platform.h"
+
+enum pico_error_codes {
+	PICO_OK = 0,
+	PICO_ERROR_NONE = 0,
+	PICO_ERROR_TIMEOUT = -1,
+	PICO_ERROR_GENERIC = -2,
+};
+
+// Raspberry Pi Pico board pins
+#define PICO_DEFAULT_I2C 0
+#define PICO_DEFAULT_I2C_SDA_PIN 4
+#define PICO_DEFAULT_I2C_SCL_PIN 5
+#define PICO_DEFAULT_SPI 0
+#define PICO_DEFAULT_SPI_SCK_PIN 18
+#define PICO_DEFAULT_SPI_TX_PIN 19
+#define PICO_DEFAULT_SPI_RX_PIN 16
+#define PICO_DEFAULT_SPI_CSN_PIN 17
@@ -0,0 +1,5 @@
+#pragma once
+
+// Binary info only exists in RP2040 images
+#define bi_decl(_decl)
+#define bi_decl_if_func_used(_decl)
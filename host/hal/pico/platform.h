@@ -0,0 +1,17 @@
+#pragma once
+
+#include <assert.h>
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Spin loop body, lets one microsecond of simulated time pass
+void tight_loop_contents(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define hard_assert(x) do { if(!(x)) __builtin_trap(); } while(0)
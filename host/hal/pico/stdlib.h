@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "pico.h"
+#include "pico/time.h"
+#include "hardware/gpio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// printf goes to the host's stdout
+bool stdio_init_all(void);
+
+#ifdef __cplusplus
+}
+#endif
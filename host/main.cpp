@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+#include <GFX.hpp>
+#include <MAX31865.hpp>
+#include <FlashLog.hpp>
+#include <Profiler.hpp>
+#include <Telemetry.hpp>
+#include <App.hpp>
+#include "Sim.hpp"
+#include "SSD1306Model.hpp"
+#include "MAX31865Model.hpp"
+#include "FileFlash.hpp"
+#include "PtyPort.hpp"
+
+#define LOG_SECTORS 64
+
+// Without a pseudo-terminal the frames are still built, then thrown away
+class DiscardPort : public TelemetryPort {
+    public:
+        bool send(const uint8_t *, size_t) override { return true; }
+};
+
+/*!
+ * @brief The example application on simulated hardware, both cores' work in one loop.
+ * Usage: pico-temp-logger-sim [seconds] [frame.pbm] [flash.bin] [--pty]
+ * With --pty the telemetry stream goes to a pseudo-terminal, read it with telemetry-decode.
+ */
+int main(int argc, char * argv[]) {
+    const uint32_t seconds = argc > 1 ? strtoul(argv[1], nullptr, 10) : 600;
+    const char * frame_path = argc > 2 ? argv[2] : "frame.pbm";
+    const char * flash_path = argc > 3 ? argv[3] : "flash.bin";
+    const bool pty = argc > 4 && !strcmp(argv[4], "--pty");
+
+    SSD1306Model panel(128, 32);
+    MAX31865Model rtd(430);
+    FileFlash flash(flash_path, LOG_SECTORS);
+
+    sim::attach(i2c0, 0x3C, &panel);
+    sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &rtd);
+
+    stdio_init_all();
+
+    i2c_init(i2c0, 400 * 1000);
+    gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
+    gpio_set_function(PICO_DEFAULT_I2C_SCL_PIN, GPIO_FUNC_I2C);
+    gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
+    gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
+
+    spi_init(spi0, 500 * 1000);
+    spi_set_format(spi0, 8, SPI_CPOL_0, SPI_CPHA_1, SPI_MSB_FIRST);
+
+    GFX oled(0x3C, size::W128xH32, i2c0);
+    oled.clear(colors::BLACK);
+
+    FlashLog log(&flash);
+    log.begin();
+    printf("Log resumes at page sequence %lu\n", (unsigned long)log.sequence());
+
+    MAX31865 temp(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+    temp.begin(MAX31865_3WIRE);
+
+    DiscardPort discard;
+    PtyPort * port = pty ? new PtyPort() : nullptr;
+    if(port) printf("Telemetry on %s\n", port->isOpen() ? port->path() : "nothing, no pseudo-terminal");
+    fflush(stdout);
+    TelemetryWriter telemetry(port ? (TelemetryPort *)port : &discard);
+
+    static App app(&oled, &log, &telemetry);
+    app.begin();
+
+    absolute_time_t next = get_absolute_time();
+    const absolute_time_t end = make_timeout_time_ms(seconds * 1000);
+
+    while(!time_reached(end))
+    {
+        next = delayed_by_ms(next, SAMPLE_PERIOD_MS);
+
+        // A slow daily swing with some ripple on top
+        const float t = to_ms_since_boot(get_absolute_time()) / 1000.0f;
+        rtd.setTemperature(21.5f + 3 * sinf(t / 300) + 0.4f * sinf(t / 7));
+
+        uint16_t raw = temp.readRTD();
+        const max31865_snapshot_t &snapshot = temp.lastSnapshot();
+        app.add({time_us_64(), raw, snapshot.fault, snapshot.faultStatus});
+
+        app.render();
+        telemetry.poll();
+
+        sleep_until(next);
+    }
+
+    app.finish();
+
+    if(!panel.writePBM(frame_path)) printf("Could not write %s\n", frame_path);
+
+    const sim::bus_stats &i2c = sim::stats(i2c0);
+    const sim::bus_stats &spi = sim::stats(spi0);
+    const MAX31865Model::counters &conversions = rtd.counts();
+
+    printf("Simulated %lu s, log at page sequence %lu\n", (unsigned long)seconds, (unsigned long)log.sequence());
+    printf("I2C: %llu transactions, %llu bytes, %.1f%% busy\n", (unsigned long long)i2c.transactions,
+        (unsigned long long)i2c.bytes, 100.0 * i2c.busy_us / sim::now());
+    printf("SPI: %llu transactions, %llu bytes, %.1f%% busy\n", (unsigned long long)spi.transactions,
+        (unsigned long long)spi.bytes, 100.0 * spi.busy_us / sim::now());
+    printf("RTD: %lu conversions, %lu unbiased, %lu before the bias settled\n", (unsigned long)conversions.conversions,
+        (unsigned long)conversions.unbiased, (unsigned long)conversions.early);
+    printf("Panel: %lu data bytes, %lu written into a scrolling band\n", (unsigned long)panel.dataBytes(),
+        (unsigned long)panel.corruptWrites());
+    printf("Flash: %lu overwrite violations\n", (unsigned long)flash.overwriteViolations());
+    printf("Telemetry: %lu frames sent, %lu dropped\n", (unsigned long)telemetry.framesSent(),
+        (unsigned long)telemetry.framesDropped());
+
+    // Only with PICO_LOGGER_PROFILE, in simulated time, so it shows bus and conversion waits
+    Profiler::dump();
+
+    delete port;
+
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "FileFlash.hpp"
+
+#include <string.h>
+
+
+/*!
+ * @brief Open or create the backing file, a new file starts erased.
+ * @param path file holding the flash content
+ * @param sectors region size in 4 KB sectors
+ */
+FileFlash::FileFlash(const char * path, uint32_t sectors) : sectors(sectors), erases(sectors, 0), random(1)
+{
+	this->file = fopen(path, "r+b");
+	if(!this->file) this->file = fopen(path, "w+b");
+
+	fseek(this->file, 0, SEEK_END);
+	long length = ftell(this->file);
+
+	// Pad short or new files with erased sectors
+	uint8_t blank[FLASH_DEVICE_SECTOR_SIZE];
+	memset(blank, 0xFF, sizeof(blank));
+	while(length < (long)this->size())
+	{
+		const long chunk = (long)this->size() - length < (long)sizeof(blank) ? (long)this->size() - length : (long)sizeof(blank);
+		length += fwrite(blank, 1, chunk, this->file);
+	}
+	fflush(this->file);
+}
+
+
+FileFlash::~FileFlash()
+{
+	fclose(this->file);
+}
+
+
+/*!
+ * @brief Read from the region, a dead device reads as all 0xFF.
+ */
+void FileFlash::read(uint32_t offset, uint8_t * data, size_t len)
+{
+	if(this->dead)
+	{
+		memset(data, 0xFF, len);
+		return;
+	}
+
+	fseek(this->file, offset, SEEK_SET);
+	if(fread(data, 1, len, this->file) != len) memset(data, 0xFF, len);
+}
+
+
+/*!
+ * @brief Erase the sector starting at offset, a torn erase leaves random bytes behind.
+ */
+void FileFlash::eraseSector(uint32_t offset)
+{
+	if(this->dead) return;
+
+	const bool torn = this->cut();
+
+	uint8_t sector[FLASH_DEVICE_SECTOR_SIZE];
+	this->read(offset, sector, sizeof(sector));
+
+	for(uint32_t i = 0; i < sizeof(sector); i++)
+	{
+		if(!torn || (this->next() & 1)) sector[i] = 0xFF;
+	}
+
+	fseek(this->file, offset, SEEK_SET);
+	fwrite(sector, 1, sizeof(sector), this->file);
+	fflush(this->file);
+
+	this->erases[offset / FLASH_DEVICE_SECTOR_SIZE]++;
+	if(torn) this->dead = true;
+}
+
+
+/*!
+ * @brief Program the page starting at offset, a torn program stops part way through.
+ */
+void FileFlash::programPage(uint32_t offset, const uint8_t * data)
+{
+	if(this->dead) return;
+
+	const bool torn = this->cut();
+	const uint32_t len = torn ? this->next() % FLASH_DEVICE_PAGE_SIZE : FLASH_DEVICE_PAGE_SIZE;
+
+	uint8_t page[FLASH_DEVICE_PAGE_SIZE];
+	this->read(offset, page, sizeof(page));
+
+	bool violation = false;
+	for(uint32_t i = 0; i < len; i++)
+	{
+		if(data[i] & ~page[i]) violation = true;
+		page[i] &= data[i];
+	}
+	if(violation) this->violations++;
+
+	fseek(this->file, offset, SEEK_SET);
+	fwrite(page, 1, sizeof(page), this->file);
+	fflush(this->file);
+
+	if(torn) this->dead = true;
+}
+
+
+/*!
+ * @brief Region size in bytes.
+ */
+uint32_t FileFlash::size()
+{
+	return this->sectors * FLASH_DEVICE_SECTOR_SIZE;
+}
+
+
+/*!
+ * @brief Let ops more erase or program operations complete, tear the one after and go dead.
+ * @param ops operations that still complete
+ * @param seed picks where the torn operation stops
+ */
+void FileFlash::cutPowerAfter(uint32_t ops, uint32_t seed)
+{
+	this->ops_left = ops;
+	this->random = seed ? seed : 1;
+}
+
+
+/*!
+ * @brief Bring a dead device back, with whatever the torn operation left.
+ */
+void FileFlash::restorePower()
+{
+	this->dead = false;
+	this->ops_left = -1;
+}
+
+
+bool FileFlash::cut()
+{
+	if(this->ops_left < 0) return false;
+	return this->ops_left-- == 0;
+}
+
+
+// xorshift32, reproducible for a given seed
+uint32_t FileFlash::next()
+{
+	this->random ^= this->random << 13;
+	this->random ^= this->random >> 17;
+	this->random ^= this->random << 5;
+	return this->random;
+}
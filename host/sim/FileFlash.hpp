@@ -0,0 +1,43 @@
+#pragma once
+
+#include "FlashDevice.hpp"
+
+#include <stdio.h>
+#include <vector>
+
+/*!
+    @brief  NOR flash region kept in a file, so a log survives between runs of the simulator.
+            Programming ANDs into the existing content like the real part. Programming bits that
+            are already 0 back to 1 cannot work on NOR flash, those pages are counted as violations.
+            cutPowerAfter() tears an operation part way through and kills the device, to test
+            recovery after a power cut.
+*/
+class FileFlash : public FlashDevice {
+	FILE * file;
+	uint32_t sectors;
+	std::vector<uint32_t> erases;
+
+	uint32_t violations = 0;
+	int64_t ops_left = -1;      // operations before the power cut, -1 for none
+	bool dead = false;
+	uint32_t random;
+
+	bool cut();
+	uint32_t next();
+
+	public:
+		FileFlash(const char * path, uint32_t sectors);
+		~FileFlash();
+
+		void read(uint32_t offset, uint8_t * data, size_t len) override;
+		void eraseSector(uint32_t offset) override;
+		void programPage(uint32_t offset, const uint8_t * data) override;
+		uint32_t size() override;
+
+		void cutPowerAfter(uint32_t ops, uint32_t seed = 1);
+		bool powerLost() const { return this->dead; }
+		void restorePower();
+
+		uint32_t eraseCount(uint32_t sector) const { return this->erases[sector]; }
+		uint32_t overwriteViolations() const { return this->violations; }
+};
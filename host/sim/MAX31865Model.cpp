@@ -0,0 +1,213 @@
+#include "MAX31865Model.hpp"
+#include "MAX31865.hpp"
+
+#include <math.h>
+
+#define ONESHOT_60HZ_US 52000
+#define ONESHOT_50HZ_US 62500
+#define AUTO_60HZ_US 16700
+#define AUTO_50HZ_US 20000
+
+
+/*!
+ * @brief Create a chip converting a 100 ohm RTD.
+ * @param ref_resistor value of the reference resistor on the board
+ * @param drdy_pin GPIO the DRDY output is wired to, -1 if not connected
+ */
+MAX31865Model::MAX31865Model(float ref_resistor, int drdy_pin) : ref_resistor(ref_resistor), drdy_pin(drdy_pin), resistance(100)
+{
+	// Power on defaults: thresholds wide open, DRDY high
+	this->regs[MAX31865_HFAULTMSB_REG] = 0xFF;
+	this->regs[MAX31865_HFAULTLSB_REG] = 0xFF;
+	this->setDrdy(true);
+}
+
+
+/*!
+ * @brief A falling chip select starts a new transaction with an address byte.
+ */
+void MAX31865Model::select()
+{
+	this->addressed = false;
+	this->stats.transactions++;
+}
+
+
+/*!
+ * @brief One byte each way, auto-incrementing through the registers.
+ */
+uint8_t MAX31865Model::transfer(uint8_t mosi)
+{
+	this->update();
+
+	if(!this->addressed)
+	{
+		this->addressed = true;
+		this->writing = mosi & 0x80;
+		this->address = mosi & 0x07;
+		return 0xFF;
+	}
+
+	uint8_t miso = 0xFF;
+
+	if(this->writing)
+	{
+		this->writeRegister(this->address, mosi);
+	}
+	else
+	{
+		miso = this->regs[this->address];
+		if(this->address == MAX31865_RTDMSB_REG || this->address == MAX31865_RTDLSB_REG) this->setDrdy(true);
+	}
+
+	this->address = (this->address + 1) & 0x07;
+	return miso;
+}
+
+
+/*!
+ * @brief Set the resistance of the RTD, used from the next conversion on.
+ */
+void MAX31865Model::setResistance(float ohms)
+{
+	this->resistance = ohms;
+}
+
+
+/*!
+ * @brief Set the RTD to the resistance of a platinum sensor at a temperature.
+ * @param celsius temperature of the sensor
+ * @param nominal resistance at 0 C, 100 for a PT100
+ */
+void MAX31865Model::setTemperature(float celsius, float nominal)
+{
+	const double t = celsius;
+	double r = 1 + RTD_A * t + RTD_B * t * t;
+	if(t < 0) r += RTD_C * (t - 100) * t * t * t;
+
+	this->resistance = nominal * r;
+}
+
+
+/*!
+ * @brief Report fault status bits at every following conversion or fault cycle, 0 stops.
+ * Latched faults stay until the driver clears them.
+ */
+void MAX31865Model::injectFault(uint8_t status)
+{
+	this->injected = status;
+}
+
+
+/*!
+ * @brief Register content as the chip holds it now.
+ */
+uint8_t MAX31865Model::reg(uint8_t address)
+{
+	this->update();
+	return this->regs[address & 0x07];
+}
+
+
+void MAX31865Model::writeRegister(uint8_t reg, uint8_t value)
+{
+	if(reg == MAX31865_FAULTSTAT_REG) return;      // read only
+
+	if(reg != MAX31865_CONFIG_REG)
+	{
+		this->regs[reg] = value;
+		return;
+	}
+
+	const uint8_t was = this->regs[MAX31865_CONFIG_REG];
+
+	// Fault status clear only acts when no one-shot or fault cycle is requested with it
+	if((value & MAX31865_CONFIG_FAULTSTAT) && !(value & (MAX31865_CONFIG_1SHOT | MAX31865_CONFIG_FAULTCYCLE)))
+	{
+		this->regs[MAX31865_FAULTSTAT_REG] = 0;
+		this->regs[MAX31865_RTDLSB_REG] &= ~1;
+	}
+
+	// Fault detection cycle, finishes before the next access
+	if(value & MAX31865_CONFIG_FAULTCYCLE) this->regs[MAX31865_FAULTSTAT_REG] |= this->injected;
+
+	this->regs[MAX31865_CONFIG_REG] = value & ~MAX31865_CONFIG_SELFCLEAR;
+
+	if((value & MAX31865_CONFIG_BIAS) && !(was & MAX31865_CONFIG_BIAS)) this->bias_since = sim::now();
+
+	const bool automatic = (value & MAX31865_CONFIG_MODEAUTO) && (value & MAX31865_CONFIG_BIAS);
+
+	if(value & MAX31865_CONFIG_1SHOT) this->start(sim::now());
+	else if(automatic && !this->converting) this->start(sim::now());
+}
+
+
+// Finish the conversions that are due, automatic mode chains the next one
+void MAX31865Model::update()
+{
+	while(this->converting && sim::now() >= this->done_at)
+	{
+		const uint64_t done = this->done_at;
+
+		this->complete();
+
+		const uint8_t config = this->regs[MAX31865_CONFIG_REG];
+		if((config & MAX31865_CONFIG_MODEAUTO) && (config & MAX31865_CONFIG_BIAS)) this->start(done);
+	}
+}
+
+
+void MAX31865Model::start(uint64_t at)
+{
+	const uint8_t config = this->regs[MAX31865_CONFIG_REG];
+
+	if(!(config & MAX31865_CONFIG_BIAS)) this->stats.unbiased++;
+	else if(at - this->bias_since < MAX31865_BIAS_SETTLE_MS * 1000) this->stats.early++;
+
+	this->converting = true;
+	this->done_at = at + this->conversionTime();
+
+	sim::schedule(this->done_at, [this]() { this->update(); });
+}
+
+
+void MAX31865Model::complete()
+{
+	this->converting = false;
+	this->stats.conversions++;
+
+	float ratio = this->resistance / this->ref_resistor;
+	if(ratio < 0) ratio = 0;
+	uint32_t code = lroundf(ratio * 32768);
+	if(code > 0x7FFF) code = 0x7FFF;
+
+	const uint16_t raw = code << 1;
+	const uint16_t high = (this->regs[MAX31865_HFAULTMSB_REG] << 8) | this->regs[MAX31865_HFAULTLSB_REG];
+	const uint16_t low = (this->regs[MAX31865_LFAULTMSB_REG] << 8) | this->regs[MAX31865_LFAULTLSB_REG];
+
+	uint8_t status = this->injected;
+	if(raw > high) status |= MAX31865_FAULT_HIGHTHRESH;
+	if(raw < low) status |= MAX31865_FAULT_LOWTHRESH;
+	this->regs[MAX31865_FAULTSTAT_REG] |= status;
+
+	this->regs[MAX31865_RTDMSB_REG] = raw >> 8;
+	this->regs[MAX31865_RTDLSB_REG] = (raw & 0xFF) | (this->regs[MAX31865_FAULTSTAT_REG] ? 1 : 0);
+
+	this->setDrdy(false);
+}
+
+
+uint64_t MAX31865Model::conversionTime() const
+{
+	const uint8_t config = this->regs[MAX31865_CONFIG_REG];
+	const bool filter50 = config & MAX31865_CONFIG_FILT50HZ;
+
+	if(config & MAX31865_CONFIG_MODEAUTO) return filter50 ? AUTO_50HZ_US : AUTO_60HZ_US;
+	return filter50 ? ONESHOT_50HZ_US : ONESHOT_60HZ_US;
+}
+
+
+void MAX31865Model::setDrdy(bool level)
+{
+	if(this->drdy_pin >= 0) sim::drivePin(this->drdy_pin, level);
+}
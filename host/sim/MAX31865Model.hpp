@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Sim.hpp"
+
+/*!
+    @brief  Register level model of a MAX31865 on SPI.
+            The RTD is a resistance set by the test, or a temperature converted with the
+            Callendar-Van Dusen equation. One-shot and automatic conversions take the datasheet
+            times for the selected filter, the result and the threshold faults appear when the
+            conversion is done and DRDY, if connected, goes low until the RTD register is read.
+            Faults injected with injectFault() show up at the next conversion or fault cycle.
+*/
+class MAX31865Model : public sim::SPIDevice {
+	public:
+		struct counters {
+			uint32_t conversions = 0;
+			uint32_t unbiased = 0;      // converted with the bias off
+			uint32_t early = 0;         // converted less than 10 ms after the bias came on
+			uint32_t transactions = 0;  // chip select cycles
+		};
+
+	private:
+		float ref_resistor;
+		int drdy_pin;
+		float resistance;
+
+		uint8_t regs[8] = {};
+		uint8_t injected = 0;
+
+		// SPI transaction state, the first byte is the address
+		bool addressed = false;
+		bool writing = false;
+		uint8_t address = 0;
+
+		bool converting = false;
+		uint64_t done_at = 0;
+		uint64_t bias_since = 0;
+
+		counters stats;
+
+		void writeRegister(uint8_t reg, uint8_t value);
+		void update();
+		void start(uint64_t at);
+		void complete();
+		uint64_t conversionTime() const;
+		void setDrdy(bool level);
+
+	public:
+		MAX31865Model(float ref_resistor = 430, int drdy_pin = -1);
+
+		void select() override;
+		uint8_t transfer(uint8_t mosi) override;
+
+		void setResistance(float ohms);
+		void setTemperature(float celsius, float nominal = 100);
+		void injectFault(uint8_t status);
+
+		uint8_t reg(uint8_t address);
+		const counters &counts() const { return this->stats; }
+};
@@ -0,0 +1,95 @@
+#include "PtyPort.hpp"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define READER_WAIT_MS 1000
+
+
+/*!
+ * @brief Open a new pseudo-terminal, check isOpen().
+ */
+PtyPort::PtyPort()
+{
+	this->master = posix_openpt(O_RDWR | O_NOCTTY);
+	if(this->master < 0) return;
+
+	if(grantpt(this->master) || unlockpt(this->master) || !ptsname(this->master))
+	{
+		close(this->master);
+		this->master = -1;
+		return;
+	}
+	strncpy(this->name, ptsname(this->master), sizeof(this->name) - 1);
+
+	// Raw mode, otherwise the line discipline rewrites CR bytes. Holding the slave open also
+	// keeps the master writable before a reader arrives.
+	this->slave = open(this->name, O_RDWR | O_NOCTTY);
+
+	struct termios tio;
+	if(this->slave >= 0 && tcgetattr(this->slave, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		tcsetattr(this->slave, TCSANOW, &tio);
+	}
+
+	fcntl(this->master, F_SETFL, fcntl(this->master, F_GETFL) | O_NONBLOCK);
+}
+
+
+PtyPort::~PtyPort()
+{
+	// Closing the master discards what the reader has not read yet, give it a moment. Writes reach
+	// the slave side asynchronously, right after the last one it can still look empty, so wait first
+	int pending = 0;
+	for(int i = 0; i < READER_WAIT_MS / 10 && this->slave >= 0; i++)
+	{
+		usleep(10 * 1000);
+		if(ioctl(this->slave, FIONREAD, &pending) || pending == 0) break;
+	}
+
+	if(this->slave >= 0) close(this->slave);
+	if(this->master >= 0) close(this->master);
+}
+
+
+/*!
+ * @brief Write a packet whole, or drop it if the reader does not keep up.
+ */
+bool PtyPort::send(const uint8_t * packet, size_t len)
+{
+	if(this->master < 0) return false;
+
+	struct pollfd pfd = {this->master, POLLOUT, 0};
+	if(poll(&pfd, 1, this->stalled ? 0 : READER_WAIT_MS) != 1 || !(pfd.revents & POLLOUT))
+	{
+		this->stalled = true;
+		return false;
+	}
+
+	size_t done = 0;
+	while(done < len)
+	{
+		const ssize_t n = write(this->master, packet + done, len - done);
+		if(n > 0)
+		{
+			done += n;
+			continue;
+		}
+
+		// Finish a packet that was started, a partial one would corrupt the stream
+		if(poll(&pfd, 1, READER_WAIT_MS) != 1)
+		{
+			this->stalled = true;
+			return false;
+		}
+	}
+
+	this->stalled = false;
+	return true;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Telemetry.hpp"
+
+/*!
+    @brief  Telemetry port on a pseudo-terminal, stands in for the USB CDC interface.
+            Read the stream from the slave side, path(), like from /dev/ttyACM0 on real hardware.
+            When the terminal buffer is full the simulator waits up to a second for a reader,
+            after that packets are dropped until the reader catches up, like an unread CDC port.
+*/
+class PtyPort : public TelemetryPort {
+	int master = -1;
+	int slave = -1;
+	char name[64] = {};
+	bool stalled = false;
+
+	public:
+		PtyPort();
+		~PtyPort();
+
+		bool send(const uint8_t * packet, size_t len) override;
+
+		bool isOpen() const { return this->master >= 0; }
+		const char * path() const { return this->name; }
+};
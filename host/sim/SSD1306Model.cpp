@@ -0,0 +1,273 @@
+#include "SSD1306Model.hpp"
+#include "SSD1306.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// About 54 oscillator clocks per row at 370 kHz with the default clock divider
+#define ROW_PERIOD_US 146
+
+namespace {
+
+	// Frames between scroll steps for each interval code
+	const uint16_t ScrollFrames[8] = {5, 64, 128, 256, 3, 4, 25, 2};
+
+};
+
+
+/*!
+ * @brief Create a powered up panel, display off and GDDRAM holding noise.
+ * @param width visible columns, 64 or 128
+ * @param height visible rows, 32 or 64
+ */
+SSD1306Model::SSD1306Model(uint8_t width, uint8_t height) : width(width), height(height)
+{
+	uint32_t noise = 0x2545F491;
+
+	for(uint8_t p = 0; p < Pages; p++)
+	{
+		for(uint8_t c = 0; c < Columns; c++)
+		{
+			noise = noise * 1664525 + 1013904223;
+			this->gddram[p][c] = noise >> 24;
+		}
+	}
+}
+
+
+/*!
+ * @brief One I2C write transaction: control bytes followed by commands or data.
+ */
+void SSD1306Model::write(const uint8_t * data, size_t len)
+{
+	size_t i = 0;
+
+	while(i < len)
+	{
+		const uint8_t control = data[i++];
+		const bool is_data = control & 0x40;
+		// With the continuation bit clear everything up to STOP is of the same kind
+		const size_t end = (control & 0x80) ? (i + 1 < len ? i + 1 : len) : len;
+
+		for(; i < end; i++)
+		{
+			if(is_data)
+			{
+				this->writeData(data[i]);
+				continue;
+			}
+
+			if(this->command_need == 0)
+			{
+				this->command_len = 0;
+				this->command_need = 1 + this->argumentsOf(data[i]);
+			}
+
+			this->command[this->command_len++] = data[i];
+			if(this->command_len == this->command_need)
+			{
+				this->command_need = 0;
+				this->runCommand();
+			}
+		}
+	}
+}
+
+
+/*!
+ * @brief GDDRAM byte as the controller holds it now.
+ */
+uint8_t SSD1306Model::ram(uint8_t page, uint8_t col) const
+{
+	this->updateScroll();
+	return this->gddram[page][col];
+}
+
+
+/*!
+ * @brief Whether a pixel of the panel is lit, in the same orientation as the driver's buffer.
+ */
+bool SSD1306Model::pixel(uint8_t x, uint8_t y) const
+{
+	if(!this->on || x >= this->width || y >= this->height) return false;
+	if(this->all_on) return true;
+
+	this->updateScroll();
+
+	const uint8_t row = (y + this->start_line + this->offset) % (Pages * 8);
+	const bool lit = this->gddram[row / 8][x] & (1 << (row % 8));
+
+	return lit != this->inverted;
+}
+
+
+/*!
+ * @brief Save what the panel shows as a binary PBM, lit pixels are black.
+ * @return false if the file could not be written
+ */
+bool SSD1306Model::writePBM(const char * path) const
+{
+	FILE * file = fopen(path, "wb");
+	if(!file) return false;
+
+	fprintf(file, "P4\n%u %u\n", this->width, this->height);
+
+	for(uint8_t y = 0; y < this->height; y++)
+	{
+		for(uint8_t x = 0; x < this->width; x += 8)
+		{
+			uint8_t bits = 0;
+			for(uint8_t b = 0; b < 8; b++)
+			{
+				if(this->pixel(x + b, y)) bits |= 0x80 >> b;
+			}
+			fputc(bits, file);
+		}
+	}
+
+	return fclose(file) == 0;
+}
+
+
+uint8_t SSD1306Model::argumentsOf(uint8_t command) const
+{
+	switch(command)
+	{
+		case SSD1306_SETHORIZSCROLL:
+		case SSD1306_SETLEFTHORIZSCROLL:
+			return 6;
+		case 0x29: // vertical and horizontal scroll setup
+		case 0x2A:
+			return 5;
+		case SSD1306_COLUMNADDR:
+		case SSD1306_PAGEADDR:
+		case 0xA3: // vertical scroll area
+			return 2;
+		case SSD1306_MEMORYMODE:
+		case SSD1306_SETCONTRAST:
+		case SSD1306_CHARGEPUMP:
+		case SSD1306_SETMULTIPLEX:
+		case SSD1306_SETDISPLAYOFFSET:
+		case SSD1306_SETDISPLAYCLOCKDIV:
+		case SSD1306_SETPRECHARGE:
+		case SSD1306_SETCOMPINS:
+		case SSD1306_SETVCOMDETECT:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+
+void SSD1306Model::runCommand()
+{
+	const uint8_t * c = this->command;
+
+	if(c[0] >= SSD1306_SETSTARTLINE && c[0] < SSD1306_SETSTARTLINE + 64)
+	{
+		this->start_line = c[0] - SSD1306_SETSTARTLINE;
+		return;
+	}
+
+	switch(c[0])
+	{
+		case SSD1306_COLUMNADDR:
+			this->col_start = this->col = c[1] & 0x7F;
+			this->col_end = c[2] & 0x7F;
+			break;
+		case SSD1306_PAGEADDR:
+			this->page_start = this->page = c[1] & 0x07;
+			this->page_end = c[2] & 0x07;
+			break;
+		case SSD1306_SETHORIZSCROLL:
+		case SSD1306_SETLEFTHORIZSCROLL:
+			this->scroll_left = c[0] == SSD1306_SETLEFTHORIZSCROLL;
+			this->scroll_start = c[2] & 0x07;
+			this->scroll_frames = ScrollFrames[c[3] & 0x07];
+			this->scroll_end = c[4] & 0x07;
+			break;
+		case SSD1306_ACTIVATESCROLL:
+			this->updateScroll();
+			this->scroll_active = true;
+			this->scroll_origin = sim::now();
+			this->scroll_steps = 0;
+			break;
+		case SSD1306_SETSCROLL:
+			this->updateScroll();
+			this->scroll_active = false;
+			break;
+		case SSD1306_SETCONTRAST:
+			this->contrast = c[1];
+			break;
+		case SSD1306_SETMULTIPLEX:
+			this->multiplex = c[1] & 0x3F;
+			break;
+		case SSD1306_SETDISPLAYOFFSET:
+			this->offset = c[1] & 0x3F;
+			break;
+		case SSD1306_DISPLAYALLON_RESUME:
+		case SSD1306_DISPLAYALLON:
+			this->all_on = c[0] == SSD1306_DISPLAYALLON;
+			break;
+		case SSD1306_NORMALDISPLAY:
+		case SSD1306_INVERTDISPLAY:
+			this->inverted = c[0] == SSD1306_INVERTDISPLAY;
+			break;
+		case SSD1306_DISPLAYOFF:
+		case SSD1306_DISPLAYON:
+			this->on = c[0] == SSD1306_DISPLAYON;
+			break;
+		default:
+			// Addressing mode, remapping and analog settings do not change the picture model
+			break;
+	}
+}
+
+
+void SSD1306Model::writeData(uint8_t byte)
+{
+	this->updateScroll();
+
+	if(this->scroll_active && this->page >= this->scroll_start && this->page <= this->scroll_end) this->corrupt_writes++;
+
+	this->gddram[this->page][this->col] = byte;
+	this->data_bytes++;
+
+	// Horizontal addressing: next column, wrapping to the next page of the window
+	if(this->col++ == this->col_end)
+	{
+		this->col = this->col_start;
+		this->page = this->page == this->page_end ? this->page_start : this->page + 1;
+	}
+}
+
+
+// Apply the scroll steps that happened since the last look
+void SSD1306Model::updateScroll() const
+{
+	if(!this->scroll_active) return;
+
+	const uint64_t step_us = (uint64_t)this->scroll_frames * (this->multiplex + 1) * ROW_PERIOD_US;
+	const uint64_t steps = (sim::now() - this->scroll_origin) / step_us;
+
+	for(; this->scroll_steps < steps; this->scroll_steps++)
+	{
+		for(uint8_t p = this->scroll_start; p <= this->scroll_end; p++)
+		{
+			uint8_t * row = this->gddram[p];
+
+			if(this->scroll_left)
+			{
+				const uint8_t first = row[0];
+				memmove(row, row + 1, Columns - 1);
+				row[Columns - 1] = first;
+			}
+			else
+			{
+				const uint8_t last = row[Columns - 1];
+				memmove(row + 1, row, Columns - 1);
+				row[0] = last;
+			}
+		}
+	}
+}
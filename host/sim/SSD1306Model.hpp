@@ -0,0 +1,70 @@
+#pragma once
+
+#include "Sim.hpp"
+
+/*!
+    @brief  Register level model of an SSD1306 on I2C.
+            Parses the control byte protocol and the command set the driver uses, keeps the
+            128x64 GDDRAM with horizontal addressing, the start line, display offset, inversion,
+            on/off state and the horizontal scroll, and renders what the panel shows.
+            Scrolling steps with simulated time, at an approximate frame rate of the configured
+            multiplex ratio. Data written into a scrolling band is counted, the real controller
+            corrupts it.
+*/
+class SSD1306Model : public sim::I2CDevice {
+	static const uint8_t Pages = 8;
+	static const uint8_t Columns = 128;
+
+	uint8_t width;
+	uint8_t height;
+	mutable uint8_t gddram[Pages][Columns];
+
+	// Command parser state, commands and their arguments may span transactions
+	uint8_t command[8];
+	uint8_t command_len = 0;
+	uint8_t command_need = 0;
+
+	uint8_t col_start = 0, col_end = Columns - 1;
+	uint8_t page_start = 0, page_end = Pages - 1;
+	uint8_t col = 0, page = 0;
+
+	bool on = false;
+	bool inverted = false;
+	bool all_on = false;
+	uint8_t contrast = 0x7F;
+	uint8_t multiplex = 63;
+	uint8_t start_line = 0;
+	uint8_t offset = 0;
+
+	bool scroll_active = false;
+	bool scroll_left = false;
+	uint8_t scroll_start = 0, scroll_end = 0;
+	uint16_t scroll_frames = 5;
+	uint64_t scroll_origin = 0;
+	mutable uint64_t scroll_steps = 0;
+
+	uint32_t data_bytes = 0;
+	uint32_t corrupt_writes = 0;
+
+	void runCommand();
+	void writeData(uint8_t byte);
+	void updateScroll() const;
+	uint8_t argumentsOf(uint8_t command) const;
+
+	public:
+		SSD1306Model(uint8_t width = 128, uint8_t height = 32);
+
+		void write(const uint8_t * data, size_t len) override;
+
+		uint8_t ram(uint8_t page, uint8_t col) const;
+		bool pixel(uint8_t x, uint8_t y) const;
+		bool writePBM(const char * path) const;
+
+		bool isOn() const { return this->on; }
+		bool isInverted() const { return this->inverted; }
+		bool isScrolling() const { return this->scroll_active; }
+		uint8_t getContrast() const { return this->contrast; }
+		uint8_t getStartLine() const { return this->start_line; }
+		uint32_t dataBytes() const { return this->data_bytes; }
+		uint32_t corruptWrites() const { return this->corrupt_writes; }
+};
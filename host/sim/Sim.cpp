@@ -0,0 +1,603 @@
+#include "Sim.hpp"
+#include "pico/stdlib.h"
+#include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+
+#include <map>
+#include <queue>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+	struct event {
+		uint64_t at;
+		uint64_t order;             // keeps events at the same time in scheduling order
+		std::function<void()> run;
+
+		bool operator>(const event &other) const
+		{
+			return this->at != other.at ? this->at > other.at : this->order > other.order;
+		}
+	};
+
+	struct pin_state {
+		bool output = false;
+		bool out_level = false;
+		bool driven = false;        // an attached device drives the line
+		bool driven_level = false;
+		bool pull_up = false;
+		uint32_t irq_events = 0;
+	};
+
+	struct i2c_bus {
+		uint baud = 100 * 1000;
+		std::map<uint8_t, sim::I2CDevice *> devices;
+		sim::bus_stats stats;
+	};
+
+	struct spi_slot {
+		sim::SPIDevice * device;
+		bool selected;
+	};
+
+	struct spi_bus {
+		uint baud = 1000 * 1000;
+		std::map<uint, spi_slot> devices;           // by chip select pin
+		sim::bus_stats stats;
+	};
+
+	struct dma_channel {
+		bool claimed = false;
+		uint64_t busy_until = 0;
+	};
+
+	struct world {
+		uint64_t now = 0;
+		uint64_t order = 0;
+		bool dispatching = false;
+		std::priority_queue<event, std::vector<event>, std::greater<event>> events;
+
+		i2c_bus i2c[2];
+		spi_bus spi[2];
+		pin_state pins[NUM_BANK0_GPIOS];
+		gpio_irq_callback_t irq_callback = nullptr;
+		dma_channel dma[NUM_DMA_CHANNELS];
+	};
+
+	world &w()
+	{
+		static world instance;
+		return instance;
+	}
+
+	i2c_hw_t i2c_hw[2];
+
+	// Bus transfers take time but are never interrupted, see Sim.hpp
+	void elapse(uint64_t us)
+	{
+		w().now += us;
+	}
+
+	uint64_t wireTime(sim::bus_stats &stats, uint64_t bits, uint baud)
+	{
+		const uint64_t us = (bits * 1000000 + baud - 1) / baud;
+		stats.busy_us += us;
+		return us;
+	}
+
+	bool level(uint pin)
+	{
+		const pin_state &p = w().pins[pin];
+		if(p.output) return p.out_level;
+		if(p.driven) return p.driven_level;
+		return p.pull_up;
+	}
+
+	// Run on every pin change, moves chip selects and raises edge interrupts
+	void levelChanged(uint pin, bool was)
+	{
+		// Only a chip select the firmware drives low selects, a floating one does not
+		const bool select = w().pins[pin].output && !w().pins[pin].out_level;
+
+		for(spi_bus &bus : w().spi)
+		{
+			auto it = bus.devices.find(pin);
+			if(it == bus.devices.end() || it->second.selected == select) continue;
+
+			it->second.selected = select;
+			if(select) it->second.device->select();
+			else it->second.device->deselect();
+		}
+
+		const bool is = level(pin);
+		if(is == was) return;
+
+		const uint32_t edge = is ? GPIO_IRQ_EDGE_RISE : GPIO_IRQ_EDGE_FALL;
+		if((w().pins[pin].irq_events & edge) && w().irq_callback)
+		{
+			sim::schedule(w().now, [pin, edge]() {
+				if((w().pins[pin].irq_events & edge) && w().irq_callback) w().irq_callback(pin, edge);
+			});
+		}
+	}
+
+	uint8_t spiTransfer(spi_inst_t * spi, uint8_t mosi)
+	{
+		uint8_t miso = 0xFF;
+
+		for(auto &slot : w().spi[spi->index].devices)
+		{
+			if(slot.second.selected) miso &= slot.second.device->transfer(mosi);
+		}
+		return miso;
+	}
+
+	void spiTransaction(spi_inst_t * spi, size_t len)
+	{
+		spi_bus &bus = w().spi[spi->index];
+		bus.stats.transactions++;
+		bus.stats.bytes += len;
+		elapse(wireTime(bus.stats, len * 8, bus.baud));
+	}
+
+};
+
+
+namespace sim {
+
+	/*!
+	 * @brief Simulated time in microseconds.
+	 */
+	uint64_t now()
+	{
+		return w().now;
+	}
+
+
+	/*!
+	 * @brief Let time pass, running the events that fall due.
+	 */
+	void advance(uint64_t us)
+	{
+		advanceTo(w().now + us);
+	}
+
+
+	/*!
+	 * @brief Let time pass up to t, running the events that fall due in order.
+	 * Inside an event time just moves on, the outer call runs what became due meanwhile.
+	 */
+	void advanceTo(uint64_t t)
+	{
+		world &world = w();
+
+		if(world.dispatching)
+		{
+			if(t > world.now) world.now = t;
+			return;
+		}
+
+		world.dispatching = true;
+
+		while(!world.events.empty() && world.events.top().at <= (t > world.now ? t : world.now))
+		{
+			event e = world.events.top();
+			world.events.pop();
+
+			if(e.at > world.now) world.now = e.at;
+			e.run();
+		}
+
+		if(t > world.now) world.now = t;
+		world.dispatching = false;
+	}
+
+
+	/*!
+	 * @brief Run event at the given time, or at the next wait if that time has passed.
+	 */
+	void schedule(uint64_t at, std::function<void()> run)
+	{
+		w().events.push({at, w().order++, run});
+	}
+
+
+	/*!
+	 * @brief Connect an I2C device at a 7-bit address.
+	 */
+	void attach(i2c_inst_t * i2c, uint8_t address, I2CDevice * device)
+	{
+		w().i2c[i2c->index].devices[address] = device;
+	}
+
+
+	/*!
+	 * @brief Disconnect an I2C device, transfers to its address are not acknowledged from now on.
+	 */
+	void detach(i2c_inst_t * i2c, uint8_t address)
+	{
+		w().i2c[i2c->index].devices.erase(address);
+	}
+
+
+	/*!
+	 * @brief Connect an SPI device, selected while cs_pin is low.
+	 */
+	void attach(spi_inst_t * spi, uint cs_pin, SPIDevice * device)
+	{
+		w().spi[spi->index].devices[cs_pin] = {device, false};
+		levelChanged(cs_pin, level(cs_pin));
+	}
+
+
+	/*!
+	 * @brief Drive an input line from a device, e.g. an interrupt output.
+	 */
+	void drivePin(uint pin, bool value)
+	{
+		const bool was = level(pin);
+		w().pins[pin].driven = true;
+		w().pins[pin].driven_level = value;
+		levelChanged(pin, was);
+	}
+
+
+	/*!
+	 * @brief Current level of a line.
+	 */
+	bool pin(uint pin)
+	{
+		return level(pin);
+	}
+
+
+	/*!
+	 * @brief Traffic on an I2C bus so far.
+	 */
+	const bus_stats &stats(i2c_inst_t * i2c)
+	{
+		return w().i2c[i2c->index].stats;
+	}
+
+
+	/*!
+	 * @brief Traffic on an SPI bus so far.
+	 */
+	const bus_stats &stats(spi_inst_t * spi)
+	{
+		return w().spi[spi->index].stats;
+	}
+
+
+	/*!
+	 * @brief Back to time 0 with no devices, events or pin state.
+	 */
+	void reset()
+	{
+		w() = world();
+		memset(i2c_hw, 0, sizeof(i2c_hw));
+	}
+
+};
+
+
+/* HAL */
+
+i2c_inst_t i2c0_inst = {&i2c_hw[0], 0};
+i2c_inst_t i2c1_inst = {&i2c_hw[1], 1};
+spi_inst_t spi0_inst = {0};
+spi_inst_t spi1_inst = {1};
+
+
+void tight_loop_contents(void)
+{
+	sim::advance(1);
+}
+
+
+bool stdio_init_all(void)
+{
+	return true;
+}
+
+
+absolute_time_t get_absolute_time(void)
+{
+	return w().now;
+}
+
+
+uint64_t time_us_64(void)
+{
+	return w().now;
+}
+
+
+uint32_t time_us_32(void)
+{
+	return (uint32_t)w().now;
+}
+
+
+void sleep_until(absolute_time_t target)
+{
+	sim::advanceTo(target);
+}
+
+
+void sleep_us(uint64_t us)
+{
+	sim::advance(us);
+}
+
+
+void sleep_ms(uint32_t ms)
+{
+	sim::advance(ms * 1000ull);
+}
+
+
+void busy_wait_us(uint64_t us)
+{
+	sim::advance(us);
+}
+
+
+void busy_wait_ms(uint32_t ms)
+{
+	sim::advance(ms * 1000ull);
+}
+
+
+void gpio_init(uint gpio)
+{
+	const bool was = level(gpio);
+	w().pins[gpio].output = false;
+	w().pins[gpio].out_level = false;
+	levelChanged(gpio, was);
+}
+
+
+void gpio_set_function(uint gpio, enum gpio_function fn)
+{
+}
+
+
+void gpio_set_dir(uint gpio, bool out)
+{
+	const bool was = level(gpio);
+	w().pins[gpio].output = out;
+	levelChanged(gpio, was);
+}
+
+
+void gpio_pull_up(uint gpio)
+{
+	const bool was = level(gpio);
+	w().pins[gpio].pull_up = true;
+	levelChanged(gpio, was);
+}
+
+
+void gpio_pull_down(uint gpio)
+{
+	const bool was = level(gpio);
+	w().pins[gpio].pull_up = false;
+	levelChanged(gpio, was);
+}
+
+
+void gpio_disable_pulls(uint gpio)
+{
+	gpio_pull_down(gpio);
+}
+
+
+void gpio_put(uint gpio, bool value)
+{
+	const bool was = level(gpio);
+	w().pins[gpio].out_level = value;
+	levelChanged(gpio, was);
+}
+
+
+bool gpio_get(uint gpio)
+{
+	return level(gpio);
+}
+
+
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+	// Level interrupts are not simulated
+	events &= GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE;
+
+	if(enabled) w().pins[gpio].irq_events |= events;
+	else w().pins[gpio].irq_events &= ~events;
+}
+
+
+void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback)
+{
+	w().irq_callback = callback;
+	gpio_set_irq_enabled(gpio, events, enabled);
+}
+
+
+uint i2c_init(i2c_inst_t * i2c, uint baudrate)
+{
+	w().i2c[i2c->index].baud = baudrate;
+	i2c->hw->enable = 1;
+	return baudrate;
+}
+
+
+void i2c_deinit(i2c_inst_t * i2c)
+{
+	i2c->hw->enable = 0;
+}
+
+
+int i2c_write_blocking(i2c_inst_t * i2c, uint8_t addr, const uint8_t * src, size_t len, bool nostop)
+{
+	i2c_bus &bus = w().i2c[i2c->index];
+
+	bus.stats.transactions++;
+	bus.stats.bytes += len + 1;
+
+	auto it = bus.devices.find(addr);
+	if(it == bus.devices.end())
+	{
+		// Address not acknowledged
+		elapse(wireTime(bus.stats, 9, bus.baud));
+		return PICO_ERROR_GENERIC;
+	}
+
+	elapse(wireTime(bus.stats, (len + 1) * 9, bus.baud));
+	it->second->write(src, len);
+	return len;
+}
+
+
+int i2c_read_blocking(i2c_inst_t * i2c, uint8_t addr, uint8_t * dst, size_t len, bool nostop)
+{
+	// No simulated device is readable
+	i2c_bus &bus = w().i2c[i2c->index];
+	bus.stats.transactions++;
+	bus.stats.bytes++;
+	elapse(wireTime(bus.stats, 9, bus.baud));
+	return PICO_ERROR_GENERIC;
+}
+
+
+uint spi_init(spi_inst_t * spi, uint baudrate)
+{
+	w().spi[spi->index].baud = baudrate;
+	return baudrate;
+}
+
+
+void spi_deinit(spi_inst_t * spi)
+{
+}
+
+
+void spi_set_format(spi_inst_t * spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order)
+{
+}
+
+
+int spi_write_read_blocking(spi_inst_t * spi, const uint8_t * src, uint8_t * dst, size_t len)
+{
+	spiTransaction(spi, len);
+	for(size_t i = 0; i < len; i++) dst[i] = spiTransfer(spi, src[i]);
+	return len;
+}
+
+
+int spi_write_blocking(spi_inst_t * spi, const uint8_t * src, size_t len)
+{
+	spiTransaction(spi, len);
+	for(size_t i = 0; i < len; i++) spiTransfer(spi, src[i]);
+	return len;
+}
+
+
+int spi_read_blocking(spi_inst_t * spi, uint8_t repeated_tx_data, uint8_t * dst, size_t len)
+{
+	spiTransaction(spi, len);
+	for(size_t i = 0; i < len; i++) dst[i] = spiTransfer(spi, repeated_tx_data);
+	return len;
+}
+
+
+int dma_claim_unused_channel(bool required)
+{
+	for(int channel = 0; channel < NUM_DMA_CHANNELS; channel++)
+	{
+		if(!w().dma[channel].claimed)
+		{
+			w().dma[channel].claimed = true;
+			return channel;
+		}
+	}
+
+	hard_assert(!required);
+	return -1;
+}
+
+
+void dma_channel_unclaim(uint channel)
+{
+	w().dma[channel].claimed = false;
+}
+
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+	dma_channel_config c = {DMA_SIZE_32, true, false, 0x3f};
+	return c;
+}
+
+
+/*
+ * The whole transfer is decoded at once: the words are split into transactions at every
+ * RESTART and STOP and handed to the addressed device. The channel then stays busy for the
+ * wire time and the I2C block reports STOP_DET, or TX_ABRT if nobody acknowledged.
+ */
+void dma_channel_configure(uint channel, const dma_channel_config * config, volatile void * write_addr,
+	const volatile void * read_addr, uint transfer_count, bool trigger)
+{
+	if(!trigger) return;
+
+	for(uint8_t index = 0; index < 2; index++)
+	{
+		i2c_hw_t * hw = &i2c_hw[index];
+		if(write_addr != &hw->data_cmd) continue;
+
+		i2c_bus &bus = w().i2c[index];
+		const uint8_t * src = (const uint8_t *)read_addr;
+		const size_t stride = config->read_increment ? (1u << config->size) : 0;
+
+		std::vector<uint8_t> transaction;
+		uint64_t bits = 0;
+		bool aborted = !hw->enable;
+
+		auto deliver = [&]() {
+			if(transaction.empty() || aborted) return;
+
+			auto it = bus.devices.find(hw->tar);
+			bus.stats.transactions++;
+			bus.stats.bytes += transaction.size() + 1;
+			bits += (transaction.size() + 1) * 9;
+
+			if(it == bus.devices.end()) aborted = true;
+			else it->second->write(transaction.data(), transaction.size());
+			transaction.clear();
+		};
+
+		for(uint i = 0; i < transfer_count && !aborted; i++, src += stride)
+		{
+			uint32_t word = src[0];
+			if(config->size >= DMA_SIZE_16) word |= src[1] << 8;
+
+			if(word & I2C_IC_DATA_CMD_RESTART_BITS) deliver();
+			transaction.push_back(word & 0xFF);
+			if(word & I2C_IC_DATA_CMD_STOP_BITS) deliver();
+		}
+		deliver();
+
+		hw->raw_intr_stat &= ~(I2C_IC_RAW_INTR_STAT_STOP_DET_BITS | I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS);
+		hw->raw_intr_stat |= aborted ? I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS : I2C_IC_RAW_INTR_STAT_STOP_DET_BITS;
+		w().dma[channel].busy_until = w().now + wireTime(bus.stats, bits, bus.baud);
+	}
+}
+
+
+bool dma_channel_is_busy(uint channel)
+{
+	return w().now < w().dma[channel].busy_until;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <functional>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hardware/i2c.h"
+#include "hardware/spi.h"
+
+/*!
+    @brief  Simulated hardware behind the host HAL.
+
+            Time is virtual and starts at 0. It only moves when the firmware waits: sleeps,
+            tight_loop_contents() and the wire time of blocking bus transfers. Scheduled events
+            and GPIO interrupts run where the firmware sleeps or spins, never in the middle of a
+            bus transfer, which is close enough for drivers that poll or sleep between steps.
+
+            Devices are attached to a bus: I2C devices by address, SPI devices by chip select pin.
+            An SPI device is selected while its chip select pin is low.
+*/
+namespace sim {
+
+	class I2CDevice {
+		public:
+			virtual ~I2CDevice() {}
+
+			// One write transaction, START to STOP
+			virtual void write(const uint8_t * data, size_t len) = 0;
+	};
+
+	class SPIDevice {
+		public:
+			virtual ~SPIDevice() {}
+
+			virtual void select() {}
+			virtual void deselect() {}
+			virtual uint8_t transfer(uint8_t mosi) = 0;
+	};
+
+	struct bus_stats {
+		uint64_t transactions = 0;
+		uint64_t bytes = 0;         // including the address byte on I2C
+		uint64_t busy_us = 0;       // wire time at the configured baud rate
+	};
+
+	uint64_t now();
+	void advance(uint64_t us);
+	void advanceTo(uint64_t t);
+	void schedule(uint64_t at, std::function<void()> event);
+
+	void attach(i2c_inst_t * i2c, uint8_t address, I2CDevice * device);
+	void attach(spi_inst_t * spi, uint cs_pin, SPIDevice * device);
+	void detach(i2c_inst_t * i2c, uint8_t address);
+
+	void drivePin(uint pin, bool level);
+	bool pin(uint pin);
+
+	const bus_stats &stats(i2c_inst_t * i2c);
+	const bus_stats &stats(spi_inst_t * spi);
+
+	void reset();
+
+};
@@ -0,0 +1,57 @@
+#include "TelemetryDecoder.hpp"
+#include "Crc.hpp"
+
+
+/*!
+ * @brief Consume stream bytes, calling visitor for every record of every good frame.
+ */
+void TelemetryDecoder::feed(const uint8_t * data, size_t len, telemetry_visitor_t visitor, void * context)
+{
+	for(size_t i = 0; i < len; i++)
+	{
+		if(data[i] != 0)
+		{
+			if(this->len < sizeof(this->buffer)) this->buffer[this->len++] = data[i];
+			else this->overflow = true;
+			continue;
+		}
+
+		// The stream may be joined mid frame, the bytes before the first delimiter are no frame.
+		// Frames start and end with a delimiter, so the empty frames in between are skipped
+		if(this->synced && this->len)
+		{
+			if(this->overflow) this->corrupt++;
+			else this->frame(visitor, context);
+		}
+
+		this->synced = true;
+		this->len = 0;
+		this->overflow = false;
+	}
+}
+
+
+void TelemetryDecoder::frame(telemetry_visitor_t visitor, void * context)
+{
+	uint8_t * f = this->buffer;
+	const size_t n = cobsDecode(this->buffer, this->len, f);
+
+	if(n < 4 || (n - 4) % TELEMETRY_RECORD_SIZE || f[0] != TELEMETRY_FRAME_TYPE
+		|| crc16(f, n - 2) != (f[n - 2] | (f[n - 1] << 8)))
+	{
+		this->corrupt++;
+		return;
+	}
+
+	const uint8_t sequence = f[1];
+	if(!this->first) this->lost += (uint8_t)(sequence - this->expected);
+	this->first = false;
+	this->expected = sequence + 1;
+	this->frames++;
+
+	for(size_t p = 2; p + 2 < n; p += TELEMETRY_RECORD_SIZE)
+	{
+		this->records++;
+		if(visitor) visitor(telemetryGetRecord(f + p), context);
+	}
+}
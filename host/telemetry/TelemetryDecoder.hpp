@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Telemetry.hpp"
+
+typedef void (*telemetry_visitor_t)(const telemetry_record &record, void * context);
+
+/*!
+    @brief  Reassembles TelemetryWriter frames from a byte stream, e.g. the CDC serial port.
+            Bytes can be fed in any chunking. Frames that fail COBS, length or CRC checks are
+            counted and skipped, and the decoder picks up again at the next delimiter.
+*/
+class TelemetryDecoder {
+	uint8_t buffer[COBS_MAX_ENCODED(TELEMETRY_FRAME_SIZE)];
+	size_t len = 0;
+	bool overflow = false;
+	bool synced = false;        // a delimiter was seen, the bytes before it are from a partial frame
+	bool first = true;
+	uint8_t expected = 0;
+
+	uint32_t frames = 0;
+	uint32_t records = 0;
+	uint32_t corrupt = 0;
+	uint32_t lost = 0;
+
+	void frame(telemetry_visitor_t visitor, void * context);
+
+	public:
+		void feed(const uint8_t * data, size_t len, telemetry_visitor_t visitor, void * context);
+
+		uint32_t framesDecoded() const { return this->frames; }
+		uint32_t recordsDecoded() const { return this->records; }
+		uint32_t framesCorrupt() const { return this->corrupt; }
+		uint32_t framesLost() const { return this->lost; }
+};
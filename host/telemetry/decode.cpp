@@ -0,0 +1,64 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "TelemetryDecoder.hpp"
+
+/*
+ * telemetry-decode [device|file|-]
+ *
+ * Reads the telemetry stream from the board's CDC port (e.g. /dev/ttyACM0), a capture file or stdin,
+ * and prints one CSV line per record: timestamp_us,channel,rtd,fault,fault_status
+ * The frame counters go to stderr at the end of the stream.
+ */
+
+namespace {
+
+	void print(const telemetry_record &record, void * context)
+	{
+		printf("%llu,%u,%u,%u,0x%02X\n", (unsigned long long)record.timestamp_us, record.channel, record.rtd & 0x7FFF,
+			record.rtd >> 15, record.fault_status);
+	}
+
+};
+
+
+int main(int argc, char * argv[]) {
+    const char * path = argc > 1 ? argv[1] : "-";
+
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY | O_NOCTTY) : STDIN_FILENO;
+    if(fd < 0)
+    {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    // Serial ports: raw bytes, no line editing or CR/LF translation
+    struct termios tio;
+    if(tcgetattr(fd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    TelemetryDecoder decoder;
+    uint8_t chunk[512];
+    ssize_t n;
+
+    // A pseudo-terminal reports EIO once the other side is closed, treat it as the end
+    while((n = read(fd, chunk, sizeof(chunk))) > 0 || (n < 0 && errno == EINTR))
+    {
+        if(n > 0) decoder.feed(chunk, n, print, nullptr);
+    }
+
+    fprintf(stderr, "%lu frames, %lu records, %lu corrupt, %lu lost\n", (unsigned long)decoder.framesDecoded(),
+        (unsigned long)decoder.recordsDecoded(), (unsigned long)decoder.framesCorrupt(), (unsigned long)decoder.framesLost());
+
+    return 0;
+}
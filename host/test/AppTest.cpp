@@ -0,0 +1,136 @@
+#include "Test.hpp"
+#include "Sim.hpp"
+#include "FileFlash.hpp"
+#include "pico/stdlib.h"
+#include <App.hpp>
+#include <RTDTable.hpp>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define TEST_FLASH "app-test.bin"
+
+namespace {
+
+	class DiscardPort : public TelemetryPort {
+		public:
+			bool send(const uint8_t *, size_t) override { return true; }
+	};
+
+	// The firmware's peripherals on the simulated board, the panel is not attached
+	struct board {
+		FileFlash flash;
+		FlashLog log;
+		DiscardPort port;
+		TelemetryWriter telemetry;
+		GFX oled;
+		App app;
+
+		board()
+			: flash((remove(TEST_FLASH), TEST_FLASH), 16), log(&flash), telemetry(&port),
+			  oled(0x3C, size::W128xH32, i2c0), app(&oled, &log, &telemetry)
+		{
+			this->log.begin();
+			this->app.begin();
+		}
+
+		~board() { remove(TEST_FLASH); }
+	};
+
+	struct logged {
+		std::vector<uint64_t> timestamps;
+		std::vector<uint16_t> codes;
+		uint32_t blocks = 0;
+	};
+
+	void decodeBlock(const uint8_t * record, size_t len, void * context)
+	{
+		logged &out = *(logged *)context;
+		SampleDecoder decoder(record, len);
+		uint64_t timestamp_us;
+		uint16_t code;
+		bool fault;
+
+		out.blocks++;
+		while(decoder.next(timestamp_us, code, fault))
+		{
+			out.timestamps.push_back(timestamp_us);
+			out.codes.push_back(code);
+		}
+	}
+
+	uint16_t codeOf(float celsius)
+	{
+		return lroundf(100 * (1 + 3.9083e-3f * celsius - 5.775e-7f * celsius * celsius) / 430 * 32768);
+	}
+
+};
+
+
+// The roll-up uses each sample's acquisition time, not the time core 0 got round to it (user-019)
+TEST(app, rollup_by_acquisition_time)
+{
+	i2c_init(i2c0, 400 * 1000);
+	board b;
+
+	// A minute of samples drained in one go, as after a flash erase stall, the clock does not move
+	const uint64_t start_us = 5000000;
+	const uint64_t drained_at = sim::now();
+
+	for(int i = 0; i < 240; i++)
+	{
+		const uint32_t second = i / 4;
+		b.app.add({start_us + i * SAMPLE_PERIOD_MS * 1000ull, codeOf(20 + second % 10), false, 0});
+	}
+	CHECK_EQ(sim::now(), drained_at);
+
+	uint32_t wrong = 0;
+	for(uint32_t second = 0; second < 60; second++)
+	{
+		const rollup_stats s = b.app.rollup().query(5 + second, 6 + second);
+		// Within one code, about 34 m°C
+		const int32_t expected = 20000 + (second % 10) * 1000;
+
+		if(s.count != 4 || abs(s.min - expected) > 40 || abs(s.max - expected) > 40) wrong++;
+	}
+	CHECK_EQ(wrong, 0);
+}
+
+
+// Dropped and late samples start a new log block, so the implicit timestamps stay right (user-016)
+TEST(app, log_timestamps_across_gaps)
+{
+	i2c_init(i2c0, 400 * 1000);
+	board b;
+
+	// Across the wrap of a 32-bit microsecond clock, 71.6 minutes after boot
+	std::vector<uint64_t> taken;
+	uint64_t t = (1ull << 32) - 50 * 1000000;
+
+	for(int i = 0; i < 400; i++)
+	{
+		t += SAMPLE_PERIOD_MS * 1000;
+
+		if(i % 97 == 50) continue;                              // dropped by a full queue
+		const uint64_t late = i % 61 == 30 ? 180000 : 0;        // taken late, behind a flash erase
+
+		taken.push_back(t + late);
+		b.app.add({t + late, (uint16_t)(8000 + i), false, 0});
+	}
+	b.app.finish();
+
+	logged out;
+	b.log.visit(decodeBlock, &out);
+
+	CHECK_EQ(out.timestamps.size(), taken.size());
+	uint32_t wrong = 0;
+	for(size_t i = 0; i < taken.size() && i < out.timestamps.size(); i++)
+	{
+		if(out.timestamps[i] != taken[i]) wrong++;
+	}
+	CHECK_EQ(wrong, 0);
+	// One block per gap, not one per sample
+	CHECK(out.blocks < 30);
+}
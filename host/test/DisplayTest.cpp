@@ -0,0 +1,383 @@
+#include "Test.hpp"
+#include "Sim.hpp"
+#include "SSD1306Model.hpp"
+#include "pico/stdlib.h"
+#include <GFX.hpp>
+
+#include <string.h>
+#include <type_traits>
+
+namespace {
+
+	// Gives the tests the framebuffer to compare GDDRAM against
+	class Display : public GFX {
+		public:
+			using GFX::GFX;
+
+			uint8_t at(uint8_t page, uint8_t col) const { return this->buffer[page * this->width + col]; }
+
+			// Random content with nothing dirty, the start state for comparing drawing paths
+			void scramble(uint32_t &state);
+			void markClean() { memset(this->dirty_start, SSD1306_PAGE_CLEAN, sizeof(this->dirty_start)); memset(this->dirty_end, SSD1306_PAGE_CLEAN, sizeof(this->dirty_end)); }
+
+			// Same framebuffer and same dirty ranges
+			bool sameAs(const Display &other) const
+			{
+				return !memcmp(this->buffer, other.buffer, this->bufferlen)
+					&& !memcmp(this->dirty_start, other.dirty_start, sizeof(this->dirty_start))
+					&& !memcmp(this->dirty_end, other.dirty_end, sizeof(this->dirty_end));
+			}
+	};
+
+	bool matches(const SSD1306Model &panel, Display &oled)
+	{
+		for(uint8_t page = 0; page < oled.getHeight() / 8; page++)
+		{
+			for(uint8_t col = 0; col < oled.getWidth(); col++)
+			{
+				if(panel.ram(page, col) != oled.at(page, col)) return false;
+			}
+		}
+		return true;
+	}
+
+	uint32_t random(uint32_t &state)
+	{
+		state = state * 1664525 + 1013904223;
+		return state >> 8;
+	}
+
+	void Display::scramble(uint32_t &state)
+	{
+		for(size_t i = 0; i < this->bufferlen; i++) this->buffer[i] = random(state);
+		this->markClean();
+	}
+
+	const colors palette[] = {colors::WHITE, colors::BLACK, colors::INVERSE};
+
+	// The per-pixel glyph path the page byte blitter replaced
+	void charPerPixel(Display &oled, int x, int y, char chr, colors color)
+	{
+		const uint8_t * font = oled.getFont();
+		const uint8_t * glyph = font + (chr - 0x20) * font[1] + 2;
+
+		for(int i = 0; i < font[1]; i++)
+		{
+			for(int j = 0; j < font[0]; j++)
+			{
+				const bool set = (glyph[i] >> j) & 1;
+				if(set && x + i >= 0 && x + i < oled.getWidth() && y + j >= 0 && y + j < oled.getHeight()) oled.drawPixel(x + i, y + j, color);
+			}
+		}
+	}
+
+	// The per-pixel reference for the span kernels, clipped like drawFillRectangle()
+	void fillPerPixel(Display &oled, int x, int y, int w, int h, colors color)
+	{
+		for(int py = y; py < y + h; py++)
+		{
+			for(int px = x; px < x + w; px++)
+			{
+				if(px >= 0 && px < oled.getWidth() && py >= 0 && py < oled.getHeight()) oled.drawPixel(px, py, color);
+			}
+		}
+	}
+
+};
+
+
+// The chart owns its history buffer, copying it would free the buffer twice (user-020)
+static_assert(!std::is_copy_constructible<TrendGraph>::value && !std::is_copy_assignable<TrendGraph>::value,
+	"TrendGraph must not be copyable");
+
+
+// Only the changed columns go over the bus (user-001)
+TEST(display, readout_update_bytes)
+{
+	SSD1306Model panel(128, 32);
+	sim::attach(i2c0, 0x3C, &panel);
+	i2c_init(i2c0, 400 * 1000);
+
+	Display oled(0x3C, size::W128xH32, i2c0);
+	oled.drawString(0, 0, "Temperature :");
+	oled.display();
+	CHECK(matches(panel, oled));
+
+	// Full frame: 512 data bytes behind one control byte, plus the window commands
+	const sim::bus_stats &i2c = sim::stats(i2c0);
+	CHECK(panel.dataBytes() >= 512);
+
+	uint64_t before = i2c.bytes;
+	oled.display();
+	CHECK_EQ(i2c.bytes - before, 0);
+
+	before = i2c.bytes;
+	oled.drawFillRectangle(oled.getWidth() - 30, 0, 30, 8, colors::BLACK);
+	oled.drawFixed(oled.getWidth() - 30, 0, 234, 1, 5, align::RIGHT);
+	oled.display();
+
+	// At most the 30 column readout, a control byte and the window commands, each with an address byte
+	CHECK(i2c.bytes - before <= 30 + 2 + 8);
+	CHECK(matches(panel, oled));
+}
+
+
+// Commands are batched, a frame costs a command and a data transaction per window (user-004)
+TEST(display, transactions_per_frame)
+{
+	SSD1306Model panel(128, 32);
+	sim::attach(i2c0, 0x3C, &panel);
+	i2c_init(i2c0, 400 * 1000);
+
+	const sim::bus_stats &i2c = sim::stats(i2c0);
+
+	Display oled(0x3C, size::W128xH32, i2c0);
+	CHECK_EQ(i2c.transactions, 1);
+	CHECK(panel.isOn());
+
+	// After construction every page is dirty and full width, they merge into one window
+	uint64_t before = i2c.transactions;
+	oled.display();
+	CHECK_EQ(i2c.transactions - before, 2);
+
+	before = i2c.transactions;
+	oled.drawPixel(3, 1);
+	oled.display();
+	CHECK_EQ(i2c.transactions - before, 2);
+
+	before = i2c.transactions;
+	oled.drawPixel(3, 1, colors::BLACK);
+	oled.drawPixel(100, 25);
+	oled.display();
+	CHECK_EQ(i2c.transactions - before, 4);
+
+	before = i2c.transactions;
+	oled.setContrast(0x20);
+	CHECK_EQ(i2c.transactions - before, 1);
+	CHECK_EQ(panel.getContrast(), 0x20);
+
+	CHECK(matches(panel, oled));
+}
+
+
+// Drawing while the controller scrolls never touches the scrolling band, and after
+// stopScroll() the next flush makes GDDRAM equal to the buffer again (user-021)
+TEST(display, gddram_after_scrolls)
+{
+	SSD1306Model panel(128, 32);
+	sim::attach(i2c0, 0x3C, &panel);
+	i2c_init(i2c0, 400 * 1000);
+
+	Display oled(0x3C, size::W128xH32, i2c0);
+	uint32_t state = 1;
+
+	for(int round = 0; round < 200; round++)
+	{
+		for(int i = 0; i < 4; i++)
+		{
+			oled.drawFillRectangle(random(state) % 120, random(state) % 28, 1 + random(state) % 8, 1 + random(state) % 4,
+				(colors)(random(state) % 3));
+		}
+		oled.drawNumber(random(state) % 100, random(state) % 24, random(state) % 1000);
+
+		const uint8_t first = random(state) % 4;
+		const uint8_t last = first + random(state) % (4 - first);
+		oled.startScroll(random(state) % 2 ? scroll::LEFT : scroll::RIGHT, first, last, (scroll_interval)(random(state) % 8));
+
+		// Keep drawing and flushing while the band moves
+		for(int i = 0; i < 3; i++)
+		{
+			oled.drawFillRectangle(random(state) % 120, random(state) % 28, 8, 4, colors::INVERSE);
+			if(i % 2) oled.display();
+			else oled.flushAsync();
+			sleep_ms(random(state) % 200);
+		}
+
+		oled.stopScroll();
+		CHECK(!panel.isScrolling());
+
+		if(round % 2) oled.display();
+		else
+		{
+			oled.flushAsync();
+			oled.waitFlush();
+		}
+
+		CHECK(matches(panel, oled));
+	}
+
+	CHECK_EQ(panel.corruptWrites(), 0);
+}
+
+
+// Drawing goes on while a flush is on the wire, it reaches the panel with the next flush (user-002)
+TEST(display, async_flush_overlap)
+{
+	SSD1306Model panel(128, 32);
+	sim::attach(i2c0, 0x3C, &panel);
+	i2c_init(i2c0, 400 * 1000);
+
+	Display oled(0x3C, size::W128xH32, i2c0);
+	oled.clear(colors::BLACK);
+	oled.drawString(0, 0, "Temperature :");
+	oled.flushAsync();
+	CHECK(oled.isFlushing());
+
+	// The flush took its own copy, drawing now changes neither it nor the panel
+	oled.drawFillRectangle(100, 16, 20, 8);
+	CHECK(oled.isFlushing());
+	CHECK_EQ(oled.at(2, 105), 0xFF);
+	CHECK_EQ(panel.ram(2, 105), 0x00);
+	CHECK_EQ(panel.ram(0, 0), oled.at(0, 0));
+
+	oled.waitFlush();
+	CHECK(!oled.isFlushing());
+
+	oled.flushAsync();
+	oled.waitFlush();
+	CHECK(matches(panel, oled));
+
+	// Blocking transfers wait for the flush in flight
+	oled.drawString(0, 8, "Max 1h      :");
+	oled.flushAsync();
+	oled.setContrast(0x10);
+	CHECK(!oled.isFlushing());
+	CHECK(matches(panel, oled));
+}
+
+
+// An aborted flush leaves the buffer dirty, so the next one makes GDDRAM match again (user-002)
+TEST(display, async_flush_abort)
+{
+	SSD1306Model panel(128, 32);
+	sim::attach(i2c0, 0x3C, &panel);
+	i2c_init(i2c0, 400 * 1000);
+
+	Display oled(0x3C, size::W128xH32, i2c0);
+	oled.display();
+
+	oled.drawString(10, 8, "12.3");
+	sim::detach(i2c0, 0x3C);
+	oled.flushAsync();
+	oled.waitFlush();
+	CHECK(!matches(panel, oled));
+
+	sim::attach(i2c0, 0x3C, &panel);
+	oled.flushAsync();
+	oled.waitFlush();
+	CHECK(matches(panel, oled));
+}
+
+
+// The compile-time geometry display draws and flushes exactly like the runtime one (user-005)
+TEST(display, fixed_geometry)
+{
+	SSD1306Model runtime_panel(128, 32);
+	SSD1306Model fixed_panel(128, 32);
+	sim::attach(i2c0, 0x3C, &runtime_panel);
+	sim::attach(i2c0, 0x3D, &fixed_panel);
+	i2c_init(i2c0, 400 * 1000);
+
+	GFX runtime(0x3C, size::W128xH32, i2c0);
+	BasicGFX<SSD1306Fixed<128, 32>> fixed(0x3D, i2c0);
+	static_assert(BasicGFX<SSD1306Fixed<128, 32>>::getWidth() == 128, "geometry is a constant");
+
+	auto draw = [](auto &oled) {
+		oled.clear(colors::BLACK);
+		oled.drawString(0, 3, "Temperature :");
+		oled.drawLine(0, 31, 127, 12);
+		oled.drawLine(64, 0, 70, 31, colors::INVERSE);
+		for(int x = 0; x < 128; x += 3) oled.drawPixel(x, (x * 7) % 32, colors::INVERSE);
+		oled.drawFixed(98, 16, -215, 1, 5, align::RIGHT);
+		oled.display();
+	};
+
+	draw(runtime);
+	draw(fixed);
+
+	CHECK_EQ(sim::stats(i2c0).transactions % 2, 0);
+	for(uint8_t page = 0; page < 4; page++)
+	{
+		for(uint8_t col = 0; col < 128; col++) CHECK_EQ(fixed_panel.ram(page, col), runtime_panel.ram(page, col));
+	}
+}
+
+
+// Rectangles and lines through the page span kernels write the same bytes and dirty ranges as drawPixel() (user-006)
+TEST(display, spans_match_pixels)
+{
+	i2c_init(i2c0, 400 * 1000);
+	Display spans(0x3C, size::W128xH64, i2c0);
+	Display pixels(0x3C, size::W128xH64, i2c0);
+
+	uint32_t state = 6;
+	uint32_t mismatches = 0;
+
+	for(int i = 0; i < 3000; i++)
+	{
+		uint32_t seed = i;
+		spans.scramble(seed);
+		seed = i;
+		pixels.scramble(seed);
+
+		// Unaligned y and h, partial pages and rectangles hanging off every edge
+		const int x = (int)(random(state) % 148) - 10;
+		const int y = (int)(random(state) % 84) - 10;
+		const int w = random(state) % 48;
+		const int h = random(state) % 40;
+		const colors color = palette[random(state) % 3];
+
+		switch(i % 3)
+		{
+			case 0:
+				spans.drawFillRectangle(x, y, w, h, color);
+				fillPerPixel(pixels, x, y, w, h, color);
+				break;
+			case 1:
+				spans.drawHorizontalLine(x, y, w, color);
+				fillPerPixel(pixels, x, y, w, 1, color);
+				break;
+			case 2:
+				spans.drawVerticalLine(x, y, h, color);
+				fillPerPixel(pixels, x, y, 1, h, color);
+				break;
+		}
+
+		if(!spans.sameAs(pixels)) mismatches++;
+	}
+
+	CHECK_EQ(mismatches, 0);
+}
+
+
+// Glyphs blitted as page bytes match the per-pixel glyph path, straddling pages and clipped at every edge (user-007)
+TEST(display, glyphs_match_pixels)
+{
+	i2c_init(i2c0, 400 * 1000);
+	Display blit(0x3C, size::W128xH32, i2c0);
+	Display pixels(0x3C, size::W128xH32, i2c0);
+
+	uint32_t state = 7;
+	uint32_t mismatches = 0;
+
+	for(int i = 0; i < 3000; i++)
+	{
+		uint32_t seed = i;
+		blit.scramble(seed);
+		seed = i;
+		pixels.scramble(seed);
+
+		// Every y from fully above to fully below the screen, so most glyphs split across two pages
+		const int x = (int)(random(state) % 140) - 6;
+		const int y = (int)(random(state) % 50) - 9;
+		const char chr = 0x20 + random(state) % 95;
+		const colors color = palette[random(state) % 3];
+
+		blit.drawChar(x, y, chr, color);
+		charPerPixel(pixels, x, y, chr, color);
+
+		if(!blit.sameAs(pixels)) mismatches++;
+	}
+
+	CHECK_EQ(mismatches, 0);
+}
@@ -0,0 +1,88 @@
+#include "Test.hpp"
+#include "FileFlash.hpp"
+#include <FlashLog.hpp>
+
+#include <stdio.h>
+#include <string.h>
+
+#define TEST_FLASH "flashlog-test.bin"
+
+namespace {
+
+	struct sequence_check {
+		uint32_t records = 0;
+		uint32_t last = 0;
+		uint32_t gaps = 0;
+		bool ordered = true;
+	};
+
+	void checkRecord(const uint8_t * record, size_t len, void * context)
+	{
+		sequence_check * check = (sequence_check *)context;
+		uint32_t value;
+
+		if(len != sizeof(value))
+		{
+			check->ordered = false;
+			return;
+		}
+		memcpy(&value, record, sizeof(value));
+
+		if(check->records)
+		{
+			if(value <= check->last) check->ordered = false;
+			else if(value != check->last + 1) check->gaps++;
+		}
+
+		check->last = value;
+		check->records++;
+	}
+
+};
+
+
+// A power cut at any point loses at most the page being written, the log carries on after it (user-017)
+TEST(flashlog, power_cut_recovery)
+{
+	for(uint32_t seed = 1; seed < 60; seed++)
+	{
+		remove(TEST_FLASH);
+		uint32_t counter = 0;
+
+		{
+			FileFlash flash(TEST_FLASH, 4);
+			FlashLog log(&flash);
+			log.begin();
+
+			flash.cutPowerAfter(seed * 7, seed);
+			for(int i = 0; i < 50000 && !flash.powerLost(); i++)
+			{
+				log.append((const uint8_t *)&counter, sizeof(counter));
+				counter++;
+			}
+			CHECK(flash.powerLost());
+		}
+
+		FileFlash flash(TEST_FLASH, 4);
+		FlashLog log(&flash);
+		log.begin();
+
+		for(int i = 0; i < 300; i++)
+		{
+			log.append((const uint8_t *)&counter, sizeof(counter));
+			counter++;
+		}
+		log.flush();
+
+		sequence_check check;
+		log.visit(checkRecord, &check);
+
+		// Records staged in RAM at the cut are gone, that is the only gap allowed
+		CHECK(check.ordered);
+		CHECK(check.gaps <= 1);
+		CHECK_EQ(check.last, counter - 1);
+		CHECK_EQ(flash.overwriteViolations(), 0);
+	}
+
+	remove(TEST_FLASH);
+}
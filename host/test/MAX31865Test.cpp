@@ -0,0 +1,312 @@
+#include "Test.hpp"
+#include "Sim.hpp"
+#include "MAX31865Model.hpp"
+#include "pico/stdlib.h"
+#include <MAX31865.hpp>
+#include <MAX31865Bus.hpp>
+
+#include <math.h>
+
+namespace {
+
+	// RTD code the chip reports for a resistance
+	uint16_t codeOf(float ohms, float ref_resistor)
+	{
+		return lroundf(ohms / ref_resistor * 32768);
+	}
+
+	void initSpi()
+	{
+		spi_init(spi0, 500 * 1000);
+		spi_set_format(spi0, 8, SPI_CPOL_0, SPI_CPHA_1, SPI_MSB_FIRST);
+	}
+
+	void completed(uint16_t rtd, void * context)
+	{
+		*(uint16_t *)context = rtd;
+	}
+
+};
+
+
+// The non-blocking conversion waits out the bias settling and the conversion time (user-009)
+TEST(max31865, conversion_state_machine)
+{
+	MAX31865Model chip(430);
+	sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &chip);
+	initSpi();
+
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	rtd.begin(MAX31865_3WIRE);
+	CHECK_EQ(rtd.state(), MAX31865_IDLE);
+
+	uint16_t reported = 0;
+	rtd.setCallback(completed, &reported);
+
+	chip.setResistance(110);
+	const uint64_t start = sim::now();
+	rtd.startConversion();
+	CHECK_EQ(rtd.state(), MAX31865_BIAS_SETTLING);
+	CHECK(chip.reg(MAX31865_CONFIG_REG) & MAX31865_CONFIG_BIAS);
+
+	bool converting = false;
+	while(!rtd.poll())
+	{
+		if(rtd.state() == MAX31865_CONVERTING && !converting)
+		{
+			converting = true;
+			CHECK(sim::now() - start >= MAX31865_BIAS_SETTLE_MS * 1000);
+		}
+		sleep_ms(1);
+	}
+
+	CHECK(converting);
+	CHECK_EQ(rtd.state(), MAX31865_DONE);
+	CHECK(sim::now() - start >= (MAX31865_BIAS_SETTLE_MS + 52) * 1000);
+	CHECK(sim::now() - start <= (MAX31865_BIAS_SETTLE_MS + MAX31865_CONVERSION_MS + 2) * 1000);
+
+	CHECK_EQ(rtd.result(), codeOf(110, 430));
+	CHECK_EQ(reported, rtd.result());
+	CHECK(!rtd.lastSnapshot().fault);
+	CHECK(!(chip.reg(MAX31865_CONFIG_REG) & MAX31865_CONFIG_BIAS));
+
+	// Polling again does not start anything new
+	CHECK(rtd.poll());
+	CHECK_EQ(chip.counts().conversions, 1);
+	CHECK_EQ(chip.counts().unbiased, 0);
+	CHECK_EQ(chip.counts().early, 0);
+
+	// A threshold fault shows up in the snapshot of the same conversion
+	rtd.setThresholds(0, codeOf(100, 430) << 1);
+	rtd.readRTD();
+	CHECK(rtd.lastSnapshot().fault);
+	CHECK(rtd.lastSnapshot().faultStatus & MAX31865_FAULT_HIGHTHRESH);
+	CHECK_EQ(chip.counts().early, 0);
+}
+
+
+// A blocking read costs four register transfers: bias on, one-shot, result, bias off (user-011)
+TEST(max31865, transactions_per_read)
+{
+	MAX31865Model chip(430);
+	sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &chip);
+	initSpi();
+
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	rtd.begin(MAX31865_3WIRE);
+
+	for(int i = 0; i < 10; i++)
+	{
+		chip.setTemperature(20 + i);
+		const uint32_t before = chip.counts().transactions;
+		const uint16_t code = rtd.readRTD();
+
+		CHECK_EQ(chip.counts().transactions - before, 4);
+		CHECK(fabsf(rtd.calculateTemperature(code, 100, 430) - (20 + i)) < 0.05f);
+	}
+
+	CHECK_EQ(chip.counts().unbiased, 0);
+	CHECK_EQ(chip.counts().early, 0);
+}
+
+
+// begin() sets wiring, bias and mode in one CONFIG write, whatever the chip was left in (user-011)
+TEST(max31865, begin_transactions)
+{
+	const uint8_t modes = MAX31865_CONFIG_BIAS | MAX31865_CONFIG_MODEAUTO | MAX31865_CONFIG_3WIRE;
+
+	MAX31865Model chip(430);
+	sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &chip);
+	initSpi();
+
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+
+	// CONFIG read and write, four threshold registers and the fault clear
+	uint32_t before = chip.counts().transactions;
+	rtd.begin(MAX31865_3WIRE);
+	CHECK_EQ(chip.counts().transactions - before, 7);
+	CHECK_EQ(chip.reg(MAX31865_CONFIG_REG) & modes, MAX31865_CONFIG_3WIRE);
+
+	rtd.enableBias(true);
+	rtd.autoConvert(true);
+
+	before = chip.counts().transactions;
+	rtd.begin(MAX31865_2WIRE);
+	CHECK_EQ(chip.counts().transactions - before, 7);
+	CHECK_EQ(chip.reg(MAX31865_CONFIG_REG) & modes, 0);
+}
+
+
+// CONFIG setters write the cached register without reading it first, half the transactions of a read-modify-write (user-011)
+TEST(max31865, config_setter_transactions)
+{
+	MAX31865Model chip(430);
+	sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &chip);
+	initSpi();
+
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	rtd.begin(MAX31865_3WIRE);
+
+	// Cached: one write per setter
+	uint32_t before = chip.counts().transactions;
+	rtd.enableBias(true);
+	rtd.enable50Hz(true);
+	rtd.setWires(MAX31865_4WIRE);
+	rtd.enableBias(false);
+	CHECK_EQ(chip.counts().transactions - before, 4);
+	CHECK_EQ(chip.reg(MAX31865_CONFIG_REG), rtd.config());
+
+	// Uncached, the way every setter used to work: a read before each write
+	before = chip.counts().transactions;
+	rtd.syncConfig();
+	rtd.enableBias(true);
+	rtd.syncConfig();
+	rtd.enable50Hz(false);
+	rtd.syncConfig();
+	rtd.setWires(MAX31865_3WIRE);
+	rtd.syncConfig();
+	rtd.enableBias(false);
+	CHECK_EQ(chip.counts().transactions - before, 8);
+	CHECK_EQ(chip.reg(MAX31865_CONFIG_REG), rtd.config());
+	CHECK_EQ(rtd.config(), MAX31865_CONFIG_3WIRE);
+}
+
+
+// Eight chips on one bus convert in about the time of one (user-014)
+TEST(max31865, sweep_eight_chips)
+{
+	const uint first_cs = 6;
+
+	MAX31865Model chips[8];
+	MAX31865 * drivers[8];
+
+	initSpi();
+
+	for(uint i = 0; i < 8; i++)
+	{
+		sim::attach(spi0, first_cs + i, &chips[i]);
+		chips[i].setResistance(100 + 5 * i);
+		drivers[i] = new MAX31865(spi0, first_cs + i);
+	}
+
+	MAX31865Bus * bus = new MAX31865Bus();
+	for(uint i = 0; i < 8; i++) CHECK(bus->add(*drivers[i]));
+
+	CHECK(bus->begin(MAX31865_3WIRE));
+
+	uint16_t results[8];
+	const uint64_t start = sim::now();
+	CHECK_EQ(bus->sweep(results), 8);
+	const uint64_t elapsed = sim::now() - start;
+
+	// One bias settling and conversion window, plus the transfers for all chips
+	CHECK(elapsed < (MAX31865_BIAS_SETTLE_MS + MAX31865_CONVERSION_MS + 5) * 1000);
+
+	for(uint i = 0; i < 8; i++)
+	{
+		CHECK_EQ(results[i], codeOf(100 + 5 * i, 430));
+		CHECK_EQ(chips[i].counts().conversions, 1);
+		CHECK_EQ(chips[i].counts().early, 0);
+	}
+
+	delete bus;
+	for(uint i = 0; i < 8; i++) delete drivers[i];
+}
+
+
+// Streaming survives stop/start cycles, whenever the last conversion of a stream ends (user-010)
+TEST(max31865, streaming_restart)
+{
+	const uint drdy_pin = 20;
+
+	MAX31865Model chip(430, drdy_pin);
+	sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &chip);
+	initSpi();
+
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	rtd.begin(MAX31865_3WIRE);
+	chip.setResistance(108);
+
+	uint16_t samples[MAX31865_STREAM_DEPTH];
+	const uint32_t gaps_ms[] = {12, 0, 5, 17, 30, 12};
+
+	CHECK(rtd.startStreaming(drdy_pin));
+
+	for(uint32_t gap : gaps_ms)
+	{
+		sleep_ms(1000);
+
+		// 60 Hz filter: a result every 16.7 ms
+		const size_t count = rtd.drainSamples(samples, MAX31865_STREAM_DEPTH);
+		CHECK(count >= 55 && count <= 61);
+		CHECK_EQ(rtd.droppedSamples(), 0);
+		for(size_t i = 0; i < count; i++) CHECK_EQ(samples[i], codeOf(108, 430));
+
+		rtd.stopStreaming();
+		sleep_ms(gap);
+		CHECK(rtd.startStreaming(drdy_pin));
+	}
+
+	rtd.stopStreaming();
+	sleep_ms(100);
+	CHECK(!(chip.reg(MAX31865_CONFIG_REG) & (MAX31865_CONFIG_BIAS | MAX31865_CONFIG_MODEAUTO)));
+}
+
+
+// Streaming starts with one CONFIG write and drops the result converted while the bias settles (user-010)
+TEST(max31865, streaming_start)
+{
+	const uint drdy_pin = 20;
+
+	MAX31865Model chip(430, drdy_pin);
+	sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &chip);
+	initSpi();
+
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	rtd.begin(MAX31865_3WIRE);
+	chip.setResistance(108);
+
+	CHECK(!rtd.startStreaming(NUM_BANK0_GPIOS));
+
+	const uint32_t before = chip.counts().transactions;
+	const uint32_t converted = chip.counts().conversions;
+	CHECK(rtd.startStreaming(drdy_pin));
+	CHECK_EQ(chip.counts().transactions - before, 1);
+	CHECK(!rtd.startStreaming(drdy_pin));
+
+	sleep_ms(1000);
+
+	uint16_t samples[MAX31865_STREAM_DEPTH];
+	const size_t count = rtd.drainSamples(samples, MAX31865_STREAM_DEPTH);
+	CHECK_EQ(chip.counts().early, 1);
+	CHECK_EQ(count, chip.counts().conversions - converted - 1);
+	rtd.stopStreaming();
+}
+
+
+// A chip sharing the SPI instance of a MAX31865Bus cannot stream, its interrupt would cut into a sweep (user-010)
+TEST(max31865, no_streaming_beside_a_sweep)
+{
+	const uint drdy_pin = 20;
+
+	MAX31865Model chip(430, drdy_pin), other;
+	sim::attach(spi0, PICO_DEFAULT_SPI_CSN_PIN, &chip);
+	sim::attach(spi0, 6, &other);
+	initSpi();
+
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	MAX31865 swept(spi0, 6);
+	rtd.begin(MAX31865_3WIRE);
+
+	MAX31865Bus * bus = new MAX31865Bus();
+	CHECK(bus->add(swept));
+	CHECK(!rtd.startStreaming(drdy_pin));
+	delete bus;
+
+	CHECK(rtd.startStreaming(drdy_pin));
+	bus = new MAX31865Bus();
+	CHECK(!bus->add(swept));
+	rtd.stopStreaming();
+	CHECK(bus->add(swept));
+	delete bus;
+}
@@ -0,0 +1,59 @@
+#include "Test.hpp"
+#include "pico/stdlib.h"
+#include <MAX31865.hpp>
+#include <RTDTable.hpp>
+
+#include <math.h>
+#include <stdio.h>
+
+#define RTD_TABLE_MAX_ERROR_MILLI 10.0     // measured 8.10 m°C for both sensor types
+
+namespace {
+
+	// Largest difference from the float conversion over every code, in m°C
+	template <uint32_t RTDnominal, uint32_t refResistor>
+	double maxError(MAX31865 &rtd, bool &monotonic)
+	{
+		typedef RTDTable<RTDnominal, refResistor> table;
+
+		double worst = 0;
+		int32_t previous = INT32_MIN;
+		monotonic = true;
+
+		for(uint32_t code = 0; code < 32768; code++)
+		{
+			const int32_t milli = table::temperatureMilli(code);
+			const double reference = rtd.calculateTemperature(code, RTDnominal, refResistor) * 1000.0;
+			const double error = fabs(milli - reference);
+
+			if(error > worst) worst = error;
+			if(milli < previous) monotonic = false;
+			previous = milli;
+		}
+
+		printf("RTDTable<%lu, %lu>: max error %.2f m°C\n", (unsigned long)RTDnominal, (unsigned long)refResistor, worst);
+		return worst;
+	}
+
+};
+
+
+// The table matches MAX31865::calculateTemperature() over all 32768 codes (user-012)
+TEST(rtdtable, all_codes_pt100)
+{
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	bool monotonic;
+
+	CHECK((maxError<100, 430>(rtd, monotonic)) <= RTD_TABLE_MAX_ERROR_MILLI);
+	CHECK(monotonic);
+}
+
+
+TEST(rtdtable, all_codes_pt1000)
+{
+	MAX31865 rtd(spi0, PICO_DEFAULT_SPI_CSN_PIN);
+	bool monotonic;
+
+	CHECK((maxError<1000, 4300>(rtd, monotonic)) <= RTD_TABLE_MAX_ERROR_MILLI);
+	CHECK(monotonic);
+}
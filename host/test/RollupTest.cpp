@@ -0,0 +1,112 @@
+#include "Test.hpp"
+#include <Rollup.hpp>
+
+#include <algorithm>
+#include <vector>
+
+#define ROLLUP_DAYS 7
+
+namespace {
+
+	struct point {
+		uint32_t time_s;
+		int32_t value;
+	};
+
+	// Tier layout of Rollup, finest first
+	const uint32_t period[] = {1, 60, 3600, 86400};
+	const uint32_t slots[] = {60, 60, 24, ROLLUP_DAYS};
+
+	uint32_t state = 1;
+
+	uint32_t random(uint32_t range)
+	{
+		state = state * 1664525 + 1013904223;
+		return (state >> 8) % range;
+	}
+
+	// Oldest time whose period tier still holds
+	uint64_t retainedFrom(int tier, uint32_t latest)
+	{
+		const uint64_t newest = latest / period[tier];
+		return (newest >= slots[tier] ? newest - slots[tier] + 1 : 0) * period[tier];
+	}
+
+	rollup_stats bruteForce(const std::vector<point> &points, uint64_t from, uint64_t to)
+	{
+		rollup_stats out;
+		auto it = std::lower_bound(points.begin(), points.end(), from, [](const point &p, uint64_t t) { return p.time_s < t; });
+
+		for(; it != points.end() && it->time_s < to; ++it) out.add(it->value);
+		return out;
+	}
+
+	bool same(const rollup_stats &a, const rollup_stats &b)
+	{
+		return a.count == b.count && a.sum == b.sum && (a.count == 0 || (a.min == b.min && a.max == b.max));
+	}
+
+	// What a window query leaves out is older data, the rest must agree with the samples
+	bool subset(const rollup_stats &part, const rollup_stats &all)
+	{
+		if(part.count > all.count) return false;
+		return part.count == 0 || (part.min >= all.min && part.max <= all.max);
+	}
+
+};
+
+
+// Window queries against a plain scan of every sample, over ten days with gaps (user-019)
+TEST(rollup, matches_brute_force)
+{
+	static Rollup<ROLLUP_DAYS> rollup;
+	std::vector<point> points;
+
+	uint32_t now = 1000003;     // not aligned to any tier
+	int32_t value = 21000;
+	uint32_t exact = 0, mismatches = 0, overreach = 0;
+
+	while(now < 1000003 + 10 * 86400)
+	{
+		// Mostly a few seconds apart, with the odd outage of hours and one of two days
+		const uint32_t r = random(10000);
+		now += r == 0 ? 2 * 86400 : (r < 2 ? 3600 + random(3 * 3600) : 1 + random(20));
+		value += (int32_t)random(201) - 100;
+
+		rollup.add(now, value);
+		points.push_back({now, value});
+
+		if(points.size() % 97) continue;
+
+		// A window whose edges fall on whole periods of a tier that still holds it is fully covered
+		for(int q = 0; q < 4; q++)
+		{
+			const int tier = random(4);
+			const uint64_t p = period[tier];
+			const uint64_t oldest = (retainedFrom(tier, now) + p - 1) / p;
+			const uint64_t newest = ((uint64_t)now + 1) / p;
+			if(newest <= oldest) continue;
+
+			const uint64_t from = (oldest + random(newest - oldest)) * p;
+			const uint64_t to = random(4) ? (from / p + 1 + random(newest - from / p)) * p : (uint64_t)now + 1;
+
+			if(!same(rollup.query(from, to), bruteForce(points, from, to))) mismatches++;
+			exact++;
+		}
+
+		if(!same(rollup.last(60), bruteForce(points, now - 59, (uint64_t)now + 1))) mismatches++;
+
+		// Any other window may lose its oldest part, but never reports samples that are not there
+		for(int q = 0; q < 4; q++)
+		{
+			const uint32_t from = now - random(ROLLUP_DAYS * 86400);
+			const uint32_t to = from + random(now + 1 - from) + 1;
+
+			if(!subset(rollup.query(from, to), bruteForce(points, from, to))) overreach++;
+		}
+	}
+
+	CHECK_EQ(mismatches, 0);
+	CHECK_EQ(overreach, 0);
+	CHECK(exact > 1000);
+}
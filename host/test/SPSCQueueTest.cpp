@@ -0,0 +1,94 @@
+#include "Test.hpp"
+#include <SPSCQueue.hpp>
+
+#include <thread>
+
+#define STRESS_ITEMS 1000000
+
+namespace {
+
+	// Wider than a word, so a slot read while the producer writes it shows up as a mismatch
+	struct item {
+		uint32_t sequence;
+		uint32_t check;
+		uint64_t payload;
+	};
+
+	item make(uint32_t sequence)
+	{
+		return {sequence, ~sequence, (uint64_t)sequence * 0x9E3779B97F4A7C15ull};
+	}
+
+	bool intact(const item &i)
+	{
+		return i.check == ~i.sequence && i.payload == (uint64_t)i.sequence * 0x9E3779B97F4A7C15ull;
+	}
+
+};
+
+
+// A producer and a consumer thread hammer a small queue, every item arrives once, intact and in order (user-016)
+TEST(spscqueue, threaded_stress)
+{
+	static SPSCQueue<item, 8> queue;
+	uint32_t full = 0;
+
+	std::thread producer([&]() {
+		for(uint32_t i = 0; i < STRESS_ITEMS; i++)
+		{
+			while(!queue.push(make(i)))
+			{
+				full++;
+				std::this_thread::yield();      // the host may have a single CPU
+			}
+		}
+	});
+
+	uint32_t expected = 0, torn = 0, out_of_order = 0, empty = 0;
+	item batch[5];
+
+	while(expected < STRESS_ITEMS)
+	{
+		// Alternate the single and the batch pop, both move the tail
+		size_t n = (expected & 1) ? queue.pop(batch, 5) : queue.pop(batch[0]);
+		if(n == 0)
+		{
+			empty++;
+			std::this_thread::yield();
+		}
+
+		for(size_t k = 0; k < n; k++)
+		{
+			if(!intact(batch[k])) torn++;
+			if(batch[k].sequence != expected) out_of_order++;
+			expected++;
+		}
+	}
+
+	producer.join();
+
+	CHECK_EQ(torn, 0);
+	CHECK_EQ(out_of_order, 0);
+	CHECK(queue.empty());
+	// Both sides waited on each other at some point, so the full and empty paths ran
+	CHECK(full > 0);
+	CHECK(empty > 0);
+	CHECK_EQ(queue.dropped(), full);
+}
+
+
+// A push into a full queue is counted, the consumer can report it (user-016)
+TEST(spscqueue, drops_counted)
+{
+	SPSCQueue<uint32_t, 4> queue;
+	uint32_t item;
+
+	for(uint32_t i = 0; i < 7; i++) queue.push(i);
+	CHECK_EQ(queue.dropped(), 3);
+	CHECK_EQ(queue.size(), 4);
+
+	// Room again, nothing more is dropped
+	CHECK(queue.pop(item));
+	CHECK(queue.push(7));
+	CHECK_EQ(queue.dropped(), 3);
+}
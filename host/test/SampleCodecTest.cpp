@@ -0,0 +1,50 @@
+#include "Test.hpp"
+#include <SampleCodec.hpp>
+
+#define BLOCK_SIZE 243
+
+// A block started just before a 32-bit microsecond clock would wrap decodes to 64-bit times past it (user-018)
+TEST(codec, timestamps_past_32_bits)
+{
+	uint8_t block[BLOCK_SIZE];
+	SampleEncoder encoder(block, sizeof(block));
+
+	const uint64_t start_us = (1ull << 32) - 10 * 1000000;
+	encoder.begin(start_us, 250);
+	for(int i = 0; i < 200; i++) CHECK(encoder.add(8200 + (i % 7) * 3, i == 120));
+
+	SampleDecoder decoder(block, encoder.finish());
+	CHECK(decoder.valid());
+	CHECK_EQ(decoder.start(), start_us);
+
+	uint64_t timestamp_us;
+	uint16_t code;
+	bool fault;
+	uint32_t decoded = 0, wrong = 0;
+
+	while(decoder.next(timestamp_us, code, fault))
+	{
+		if(timestamp_us != start_us + decoded * 250000ull) wrong++;
+		if(code != 8200 + (decoded % 7) * 3 || fault != (decoded == 120)) wrong++;
+		decoded++;
+	}
+
+	CHECK_EQ(decoded, 200);
+	CHECK_EQ(wrong, 0);
+}
+
+
+// Blocks in the earlier 32-bit layout are not misread
+TEST(codec, rejects_other_versions)
+{
+	uint8_t block[BLOCK_SIZE];
+	SampleEncoder encoder(block, sizeof(block));
+
+	encoder.begin(0, 250);
+	encoder.add(8200, false);
+	const size_t len = encoder.finish();
+
+	block[0] = 0xB1;
+	SampleDecoder decoder(block, len);
+	CHECK(!decoder.valid());
+}
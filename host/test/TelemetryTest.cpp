@@ -0,0 +1,129 @@
+#include "Test.hpp"
+#include "TelemetryDecoder.hpp"
+
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LOOPBACK_SECONDS 60
+
+namespace {
+
+	struct stream {
+		uint32_t records = 0;
+		uint32_t backwards = 0;     // records older than the one before
+		uint64_t last_us = 0;
+	};
+
+	void count(const telemetry_record &record, void * context)
+	{
+		stream &s = *(stream *)context;
+
+		if(s.records && record.timestamp_us <= s.last_us) s.backwards++;
+		s.last_us = record.timestamp_us;
+		s.records++;
+	}
+
+	// Keeps every packet, as a port with unlimited room
+	class CapturePort : public TelemetryPort {
+		public:
+			std::vector<uint8_t> bytes;
+
+			bool send(const uint8_t * packet, size_t len) override
+			{
+				this->bytes.insert(this->bytes.end(), packet, packet + len);
+				return true;
+			}
+	};
+
+	void collect(const telemetry_record &record, void * context)
+	{
+		((std::vector<telemetry_record> *)context)->push_back(record);
+	}
+
+};
+
+
+// Records taken after a 32-bit microsecond clock would wrap keep their full 64-bit timestamps (user-025)
+TEST(telemetry, timestamps_past_32_bits)
+{
+	CapturePort port;
+	TelemetryWriter writer(&port);
+
+	const uint64_t start_us = (1ull << 32) - 10 * 250000;
+	for(uint32_t i = 0; i < 30; i++) writer.add({start_us + i * 250000ull, 0, 0, (uint16_t)(8200 + i)});
+	writer.flush();
+
+	TelemetryDecoder decoder;
+	std::vector<telemetry_record> records;
+	decoder.feed(port.bytes.data(), port.bytes.size(), collect, &records);
+
+	CHECK_EQ(decoder.framesCorrupt(), 0);
+	CHECK_EQ(decoder.framesDecoded(), writer.framesSent());
+	CHECK_EQ(records.size(), 30);
+
+	uint32_t wrong = 0;
+	for(uint32_t i = 0; i < records.size(); i++)
+	{
+		if(records[i].timestamp_us != start_us + i * 250000ull || records[i].rtd != 8200 + i) wrong++;
+	}
+	CHECK_EQ(wrong, 0);
+}
+
+
+// The simulator's --pty stream decodes back to every frame it reports as sent (user-025)
+TEST(telemetry, pty_loopback)
+{
+	remove("loopback-flash.bin");
+
+	char command[512];
+	snprintf(command, sizeof(command), "%s %d loopback-frame.pbm loopback-flash.bin --pty", PICO_LOGGER_SIM_PATH, LOOPBACK_SECONDS);
+
+	FILE * sim = popen(command, "r");
+	CHECK(sim != nullptr);
+	if(!sim) return;
+
+	char line[256];
+	char path[128] = {};
+	unsigned long sent = 0, dropped = 0;
+	bool reported = false;
+
+	// The pseudo-terminal is announced before the first sample, the counters come at the end
+	while(!path[0] && fgets(line, sizeof(line), sim)) sscanf(line, "Telemetry on %127s", path);
+
+	const int fd = path[0] == '/' ? open(path, O_RDONLY | O_NOCTTY) : -1;
+	CHECK(fd >= 0);
+
+	TelemetryDecoder decoder;
+	stream s;
+	uint8_t chunk[512];
+	ssize_t n;
+
+	// Until the simulator closes its side, which reads as EIO or end of file
+	while(fd >= 0 && ((n = read(fd, chunk, sizeof(chunk))) > 0 || (n < 0 && errno == EINTR)))
+	{
+		if(n > 0) decoder.feed(chunk, n, count, &s);
+	}
+	if(fd >= 0) close(fd);
+
+	while(fgets(line, sizeof(line), sim))
+	{
+		if(sscanf(line, "Telemetry: %lu frames sent, %lu dropped", &sent, &dropped) == 2) reported = true;
+	}
+	CHECK_EQ(pclose(sim), 0);
+
+	CHECK(reported);
+	CHECK(sent > 0);
+	CHECK_EQ(dropped, 0);
+	CHECK_EQ(decoder.framesDecoded(), sent);
+	CHECK_EQ(decoder.framesLost(), 0);
+	CHECK_EQ(decoder.framesCorrupt(), 0);
+	// Every sample goes out once, in order
+	CHECK(s.records >= LOOPBACK_SECONDS * 1000 / 250 - 1);
+	CHECK_EQ(s.backwards, 0);
+}
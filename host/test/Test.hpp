@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdint.h>
+
+/*!
+    @brief  Small test harness for the host build.
+            TEST(suite, name) registers a test, CHECK() and CHECK_EQ() record a failure and go on.
+            The runner resets the simulated hardware before every test, see main.cpp.
+*/
+namespace test {
+
+	typedef void (*test_function)();
+
+	struct registration {
+		registration(const char * suite, const char * name, test_function function);
+	};
+
+	void fail(const char * file, int line, const char * expression);
+	void failEqual(const char * file, int line, const char * expression, long long actual, long long expected);
+
+};
+
+#define TEST(suite, name) \
+	static void suite##_##name(); \
+	static test::registration suite##_##name##_registration(#suite, #name, suite##_##name); \
+	static void suite##_##name()
+
+#define CHECK(expression) \
+	do { if(!(expression)) test::fail(__FILE__, __LINE__, #expression); } while(0)
+
+#define CHECK_EQ(actual, expected) \
+	do { \
+		const long long _actual = (long long)(actual), _expected = (long long)(expected); \
+		if(_actual != _expected) test::failEqual(__FILE__, __LINE__, #actual " == " #expected, _actual, _expected); \
+	} while(0)
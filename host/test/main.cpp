@@ -0,0 +1,75 @@
+#include "Test.hpp"
+#include "Sim.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+	struct test_case {
+		const char * suite;
+		const char * name;
+		test::test_function function;
+	};
+
+	// Function local, registrations run during static initialisation of the other files
+	std::vector<test_case> &registry()
+	{
+		static std::vector<test_case> tests;
+		return tests;
+	}
+
+	uint32_t failures = 0;
+
+};
+
+
+test::registration::registration(const char * suite, const char * name, test_function function)
+{
+	registry().push_back({suite, name, function});
+}
+
+
+void test::fail(const char * file, int line, const char * expression)
+{
+	printf("%s:%d: CHECK(%s) failed\n", file, line, expression);
+	failures++;
+}
+
+
+void test::failEqual(const char * file, int line, const char * expression, long long actual, long long expected)
+{
+	printf("%s:%d: CHECK_EQ(%s) failed, got %lld, expected %lld\n", file, line, expression, actual, expected);
+	failures++;
+}
+
+
+/*!
+ * @brief Run the tests of one suite, or all of them.
+ * Usage: pico-logger-tests [suite]
+ */
+int main(int argc, char * argv[]) {
+    const char * suite = argc > 1 ? argv[1] : nullptr;
+    uint32_t run = 0;
+    uint32_t failed = 0;
+
+    for(const test_case &t : registry())
+    {
+        if(suite && strcmp(suite, t.suite)) continue;
+
+        sim::reset();
+
+        const uint32_t before = failures;
+        t.function();
+        run++;
+
+        const bool passed = failures == before;
+        if(!passed) failed++;
+        printf("%s %s.%s\n", passed ? "PASS" : "FAIL", t.suite, t.name);
+    }
+
+    printf("%lu tests, %lu failed\n", (unsigned long)run, (unsigned long)failed);
+
+    return run == 0 || failed ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+#include "App.hpp"
+#include "RTDTable.hpp"
+#include "Profiler.hpp"
+#include "pico/stdlib.h"
+
+// PT100 with a 430 ohm reference resistor
+typedef RTDTable<100, 430> pt100;
+
+// Main loop stages, see Profiler.hpp
+PROFILE_STAGE(profile_convert, "loop: convert and roll up");
+PROFILE_STAGE(profile_render, "loop: render and flush");
+
+
+/*!
+ * @brief Set up the application on started peripherals.
+ * @param oled display, drawn on by begin() and render()
+ * @param log flash log receiving the codec blocks, after its begin()
+ * @param telemetry stream every sample is added to, the caller polls it
+ */
+App::App(GFX * oled, FlashLog * log, TelemetryWriter * telemetry)
+	: oled(oled), log(log), telemetry(telemetry), encoder(block, sizeof(block)),
+	  trend(oled, 0, 17, oled->getWidth(), oled->getHeight() - 17)
+{
+}
+
+
+/*!
+ * @brief Draw the static part of the screen, once.
+ */
+void App::begin()
+{
+	this->oled->drawString(0, 0, "Temperature :");
+	this->oled->drawString(0, 8, "Max 1h      :");
+}
+
+
+/*!
+ * @brief Log, stream and roll up one sample.
+ * @param s the sample, in acquisition order
+ */
+void App::add(const sample &s)
+{
+	// Block timestamps are implicit, a sample off the schedule (one was dropped, or taken late) starts a new block
+	const uint64_t expected_us = this->block_start_us + (uint64_t)this->encoder.count() * SAMPLE_PERIOD_MS * 1000;
+	const uint64_t off_us = s.timestamp_us > expected_us ? s.timestamp_us - expected_us : expected_us - s.timestamp_us;
+	if(this->encoder.count() && off_us > SAMPLE_PERIOD_MS * 1000 / 2) this->writeBlock();
+
+	if(this->encoder.count() == 0) this->startBlock(s.timestamp_us);
+
+	if(!this->encoder.add(s.rtd, s.fault))
+	{
+		this->writeBlock();
+		this->startBlock(s.timestamp_us);
+		this->encoder.add(s.rtd, s.fault);
+	}
+
+	this->telemetry->add({s.timestamp_us, 0, s.fault_status, (uint16_t)(s.rtd | (s.fault ? 0x8000 : 0))});
+
+	LATENCY_PROBE(profile_convert);
+
+	// Keyed on acquisition time, samples that waited in the queue still land in their own second
+	uint32_t now_s = s.timestamp_us / 1000000;
+	if(!s.fault) this->history.add(now_s, pt100::temperatureMilli(s.rtd));
+
+	// Plot the mean of each finished period
+	if(now_s / TREND_PERIOD_S != this->trend_period)
+	{
+		rollup_stats period = this->history.query(this->trend_period * TREND_PERIOD_S, (this->trend_period + 1) * TREND_PERIOD_S);
+		if(period.count) this->trend.push(period.mean());
+		this->trend_period = now_s / TREND_PERIOD_S;
+	}
+
+	this->latest = s;
+	this->updated = true;
+}
+
+
+/*!
+ * @brief Show the latest sample and the hourly maximum, then flush the display in the background.
+ * @return false if there was no new sample since the last call, nothing is drawn then
+ */
+bool App::render()
+{
+	if(!this->updated) return false;
+	this->updated = false;
+
+	LATENCY_PROBE(profile_render);
+
+	GFX * oled = this->oled;
+	int32_t temperature = pt100::temperatureMilli(this->latest.rtd);
+
+	// Only redraw the readouts, so the flush just sends the columns that changed
+	oled->drawFillRectangle(oled->getWidth() - 30, 0, 30, 8, colors::BLACK);
+	if(this->latest.fault) oled->drawString(oled->getWidth() - 30, 0, "FAULT");
+	else oled->drawFixed(oled->getWidth() - 30, 0, temperature / 100, 1, 5, align::RIGHT);
+	rollup_stats hour = this->history.last(3600);
+	oled->drawFillRectangle(oled->getWidth() - 30, 8, 30, 8, colors::BLACK);
+	if(hour.count) oled->drawFixed(oled->getWidth() - 30, 8, hour.max / 100, 1, 5, align::RIGHT);
+
+	oled->flushAsync();                 //Send buffer to the screen in the background
+	return true;
+}
+
+
+/*!
+ * @brief Write out the partial codec block and everything staged, before shutting down.
+ */
+void App::finish()
+{
+	if(this->encoder.count()) this->writeBlock();
+	this->log->flush();
+	this->telemetry->flush();
+}
+
+
+/*!
+ * @brief Start an empty codec block.
+ * @param start_us timestamp of its first sample
+ */
+void App::startBlock(uint64_t start_us)
+{
+	this->encoder.begin(start_us, SAMPLE_PERIOD_MS);
+	this->block_start_us = start_us;
+}
+
+
+/*!
+ * @brief Program the current block into the log, the encoder is empty afterwards.
+ */
+void App::writeBlock()
+{
+	// A block fills a page by itself, program it now rather than on the next append()
+	this->log->append(this->block, this->encoder.finish());
+	this->log->flush();
+
+	// Empty again, so the next add() starts a new block
+	this->startBlock(this->block_start_us);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "GFX.hpp"
+#include "FlashLog.hpp"
+#include "SampleCodec.hpp"
+#include "Rollup.hpp"
+#include "Telemetry.hpp"
+
+#define SAMPLE_PERIOD_MS 250
+#define TREND_PERIOD_S 15          // one graph column per 15 s, 32 minutes across the screen
+
+struct sample {
+	uint64_t timestamp_us;      // acquisition time, time_us_64()
+	uint16_t rtd;
+	bool fault;
+	uint8_t fault_status;
+};
+
+/*!
+    @brief  What the logger does with each sample, shared by the firmware and the simulator.
+            add() packs the sample into the flash log, queues it for telemetry and rolls it up
+            into minute/hour/day statistics, plotting the mean of every finished trend period.
+            render() redraws the readouts for the latest sample and starts an asynchronous flush.
+            The roll-up makes this a few KB, too big for a core's stack, so keep it static.
+*/
+class App {
+	GFX * oled;
+	FlashLog * log;
+	TelemetryWriter * telemetry;
+
+	// Samples are packed into codec blocks of one flash page, about 1 byte per sample
+	uint8_t block[FLASH_LOG_MAX_RECORD];
+	SampleEncoder encoder;
+	uint64_t block_start_us = 0;
+
+	// Temperature in milli-degrees C
+	Rollup<7> history;
+
+	// Strip chart under the readouts, scrolled one column per period
+	TrendGraph trend;
+	uint32_t trend_period = 0;
+
+	sample latest = {};
+	bool updated = false;
+
+	void startBlock(uint64_t start_us);
+	void writeBlock();
+
+	public:
+		App(GFX * oled, FlashLog * log, TelemetryWriter * telemetry);
+
+		void begin();
+		void add(const sample &s);
+		bool render();
+		void finish();
+
+		// Statistics behind the readouts and the graph, in milli-degrees C
+		const Rollup<7> &rollup() const { return this->history; }
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Worst case encoded size, without the 0x00 delimiter
+#define COBS_MAX_ENCODED(len) ((len) + (len) / 254 + 1)
+
+/*!
+ * @brief Consistent overhead byte stuffing: rewrite data so it contains no 0x00, which then delimits frames.
+ * Every run of up to 254 non-zero bytes is prefixed with its length + 1, a zero is implied after each run
+ * shorter than 254.
+ * @param data bytes to encode
+ * @param len number of bytes
+ * @param out at least COBS_MAX_ENCODED(len) bytes, must not overlap data
+ * @return encoded length
+ */
+inline size_t cobsEncode(const uint8_t * data, size_t len, uint8_t * out)
+{
+	uint8_t * code = out;       // length byte of the current run
+	uint8_t * p = out + 1;
+
+	*code = 1;
+
+	for(size_t i = 0; i < len; i++)
+	{
+		if(data[i] == 0)
+		{
+			code = p++;
+			*code = 1;
+			continue;
+		}
+
+		*p++ = data[i];
+
+		// A full run of 254 bytes ends without an implied zero
+		if(++*code == 0xFF && i + 1 < len)
+		{
+			code = p++;
+			*code = 1;
+		}
+	}
+
+	return p - out;
+}
+
+
+/*!
+ * @brief Undo cobsEncode(), the 0x00 delimiter must already be stripped.
+ * @param data encoded bytes
+ * @param len number of bytes
+ * @param out at least len bytes, may be data itself
+ * @return decoded length, 0 if data is not valid COBS
+ */
+inline size_t cobsDecode(const uint8_t * data, size_t len, uint8_t * out)
+{
+	size_t in = 0;
+	size_t n = 0;
+
+	while(in < len)
+	{
+		const uint8_t code = data[in++];
+		if(code == 0 || in + code - 1 > len) return 0;
+
+		for(uint8_t i = 1; i < code; i++)
+		{
+			if(data[in] == 0) return 0;
+			out[n++] = data[in++];
+		}
+
+		if(code < 0xFF && in < len) out[n++] = 0;
+	}
+
+	return n;
+}
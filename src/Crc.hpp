@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), four bits at a time.
+ * @param data bytes to checksum
+ * @param len number of bytes
+ * @param crc running value, to continue a CRC over several buffers
+ * @return updated CRC
+ */
+inline uint16_t crc16(const uint8_t * data, size_t len, uint16_t crc = 0xFFFF)
+{
+	static const uint16_t table[16] = {
+		0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+		0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+	};
+
+	while(len--)
+	{
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (*data >> 4)];
+		crc = (crc << 4) ^ table[(crc >> 12) ^ (*data & 0x0F)];
+		data++;
+	}
+
+	return crc;
+}
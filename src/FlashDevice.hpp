@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FLASH_DEVICE_PAGE_SIZE 256
+#define FLASH_DEVICE_SECTOR_SIZE 4096
+
+/*!
+    @brief  Region of NOR flash: erase by sector, program by page, read anything.
+            Offsets are relative to the start of the region. Programming can only clear bits,
+            so a page must be erased (all 0xFF) before it is programmed.
+*/
+class FlashDevice {
+	public:
+		virtual ~FlashDevice() {}
+
+		virtual void read(uint32_t offset, uint8_t * data, size_t len) = 0;
+		virtual void eraseSector(uint32_t offset) = 0;
+		virtual void programPage(uint32_t offset, const uint8_t * data) = 0;
+		virtual uint32_t size() = 0;
+};
+
+
+/*!
+    @brief  The last sectors of the RP2040's own QSPI flash, behind the firmware image.
+*/
+class PicoFlash : public FlashDevice {
+	uint32_t base;
+	uint32_t length;
+
+	public:
+		PicoFlash(uint32_t sectors);
+
+		void read(uint32_t offset, uint8_t * data, size_t len) override;
+		void eraseSector(uint32_t offset) override;
+		void programPage(uint32_t offset, const uint8_t * data) override;
+		uint32_t size() override;
+};
@@ -0,0 +1,208 @@
+#include "FlashLog.hpp"
+#include "Crc.hpp"
+#include <string.h>
+
+#define PAGES_PER_SECTOR (FLASH_DEVICE_SECTOR_SIZE / FLASH_DEVICE_PAGE_SIZE)
+
+namespace {
+
+	inline static void put16(uint8_t * p, uint16_t v)
+	{
+		p[0] = v;
+		p[1] = v >> 8;
+	}
+
+	inline static void put32(uint8_t * p, uint32_t v)
+	{
+		put16(p, v);
+		put16(p + 2, v >> 16);
+	}
+
+	inline static uint16_t get16(const uint8_t * p)
+	{
+		return p[0] | (p[1] << 8);
+	}
+
+	inline static uint32_t get32(const uint8_t * p)
+	{
+		return get16(p) | ((uint32_t)get16(p + 2) << 16);
+	}
+
+	inline static uint16_t pageCrc(const uint8_t * page, uint16_t used)
+	{
+		// Header up to the CRC field, then the used part of the payload
+		return crc16(page + FLASH_LOG_HEADER_SIZE, used, crc16(page, 8));
+	}
+
+};
+
+
+/*!
+ * Create a log on a flash region. Call begin() before use.
+ *
+ * @param flash flash region, a whole number of sectors, at least two
+ */
+FlashLog::FlashLog(FlashDevice * flash) : flash(flash)
+{
+	this->pages = flash->size() / FLASH_DEVICE_PAGE_SIZE;
+	memset(this->staging, 0xFF, sizeof(this->staging));
+}
+
+
+/*!
+ * @brief Find the newest valid page and continue writing after it.
+ */
+void FlashLog::begin()
+{
+	uint8_t page[FLASH_DEVICE_PAGE_SIZE];
+	uint32_t sequence;
+	bool found = false;
+	uint32_t newest_page = 0;
+	uint32_t newest_sequence = 0;
+
+	for(uint32_t p = 0; p < this->pages; p++)
+	{
+		if(!this->readPage(p, page, &sequence)) continue;
+
+		if(!found || (int32_t)(sequence - newest_sequence) > 0)
+		{
+			found = true;
+			newest_page = p;
+			newest_sequence = sequence;
+		}
+	}
+
+	this->next_page = found ? (newest_page + 1) % this->pages : 0;
+	this->next_sequence = found ? newest_sequence + 1 : 0;
+	this->staged = 0;
+	memset(this->staging, 0xFF, sizeof(this->staging));
+}
+
+
+/*!
+ * @brief Add a record. It is kept in RAM until its page is full or flush() is called.
+ *
+ * @param record record data
+ * @param len record length, 1 to FLASH_LOG_MAX_RECORD bytes
+ * @return false if the record is too long
+ */
+bool FlashLog::append(const uint8_t * record, size_t len)
+{
+	if(len == 0 || len > FLASH_LOG_MAX_RECORD) return false;
+
+	if(this->staged + 1 + len > FLASH_LOG_PAYLOAD_SIZE) this->flush();
+
+	uint8_t * p = this->staging + FLASH_LOG_HEADER_SIZE + this->staged;
+	p[0] = len;
+	memcpy(p + 1, record, len);
+	this->staged += 1 + len;
+
+	return true;
+}
+
+
+/*!
+ * @brief Program the staged records, even if the page is not full.
+ */
+void FlashLog::flush()
+{
+	if(this->staged == 0) return;
+
+	put16(this->staging, FLASH_LOG_MAGIC);
+	put16(this->staging + 2, this->staged);
+	put32(this->staging + 4, this->next_sequence);
+	put16(this->staging + 8, pageCrc(this->staging, this->staged));
+
+	// A sector is erased when the log enters it, which also drops its oldest records.
+	// Inside a sector pages are blank, unless a power cut tore one, which is skipped.
+	while(true)
+	{
+		if(this->next_page % PAGES_PER_SECTOR == 0)
+		{
+			this->flash->eraseSector(this->next_page * FLASH_DEVICE_PAGE_SIZE);
+			break;
+		}
+		if(this->isBlank(this->next_page)) break;
+
+		this->next_page = (this->next_page + 1) % this->pages;
+	}
+
+	this->flash->programPage(this->next_page * FLASH_DEVICE_PAGE_SIZE, this->staging);
+
+	this->next_page = (this->next_page + 1) % this->pages;
+	this->next_sequence++;
+	this->staged = 0;
+	memset(this->staging, 0xFF, sizeof(this->staging));
+}
+
+
+/*!
+ * @brief Call visitor for every record, oldest first, including records not flushed yet.
+ *
+ * @param visitor function called with each record
+ * @param context passed through to visitor
+ */
+void FlashLog::visit(flash_log_visitor_t visitor, void * context)
+{
+	uint8_t page[FLASH_DEVICE_PAGE_SIZE];
+	uint32_t sequence;
+
+	// Pages are written in ring order, so the oldest page follows the newest
+	for(uint32_t i = 0; i < this->pages; i++)
+	{
+		uint32_t p = (this->next_page + i) % this->pages;
+
+		if(!this->readPage(p, page, &sequence)) continue;
+
+		const uint8_t * payload = page + FLASH_LOG_HEADER_SIZE;
+		const uint16_t used = get16(page + 2);
+
+		for(uint16_t pos = 0; pos + 1 < used && pos + 1 + payload[pos] <= used; pos += 1 + payload[pos])
+		{
+			visitor(payload + pos + 1, payload[pos], context);
+		}
+	}
+
+	const uint8_t * payload = this->staging + FLASH_LOG_HEADER_SIZE;
+	for(uint16_t pos = 0; pos < this->staged; pos += 1 + payload[pos])
+	{
+		visitor(payload + pos + 1, payload[pos], context);
+	}
+}
+
+
+/*!
+ * @brief Sequence number the next page will get, i.e. the number of pages written so far.
+ */
+uint32_t FlashLog::sequence()
+{
+	return this->next_sequence;
+}
+
+
+bool FlashLog::readPage(uint32_t page, uint8_t * data, uint32_t * sequence)
+{
+	this->flash->read(page * FLASH_DEVICE_PAGE_SIZE, data, FLASH_DEVICE_PAGE_SIZE);
+
+	const uint16_t used = get16(data + 2);
+
+	if(get16(data) != FLASH_LOG_MAGIC) return false;
+	if(used == 0 || used > FLASH_LOG_PAYLOAD_SIZE) return false;
+	if(get16(data + 8) != pageCrc(data, used)) return false;
+
+	*sequence = get32(data + 4);
+	return true;
+}
+
+
+bool FlashLog::isBlank(uint32_t page)
+{
+	uint8_t data[FLASH_DEVICE_PAGE_SIZE];
+	this->flash->read(page * FLASH_DEVICE_PAGE_SIZE, data, FLASH_DEVICE_PAGE_SIZE);
+
+	for(uint8_t byte : data)
+	{
+		if(byte != 0xFF) return false;
+	}
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "FlashDevice.hpp"
+
+#define FLASH_LOG_MAGIC 0x4C47 // "LG"
+#define FLASH_LOG_HEADER_SIZE 12
+#define FLASH_LOG_PAYLOAD_SIZE (FLASH_DEVICE_PAGE_SIZE - FLASH_LOG_HEADER_SIZE)
+#define FLASH_LOG_MAX_RECORD (FLASH_LOG_PAYLOAD_SIZE - 1)
+
+typedef void (*flash_log_visitor_t)(const uint8_t * record, size_t len, void * context);
+
+/*!
+    @brief  Append-only record log on a FlashDevice.
+            Records are collected in a RAM page and programmed a full 256-byte page at a time.
+            Every page carries a sequence number and a CRC over header and payload, so a page
+            torn by a power cut is simply skipped. Sectors are reused round-robin, erasing the
+            oldest sector when the log wraps, which spreads wear evenly over the region.
+
+            Page layout: magic (2), payload bytes used (2), sequence (4), CRC-16 (2), reserved (2),
+            then records of one length byte followed by the data.
+*/
+class FlashLog {
+	FlashDevice * flash;
+	uint32_t pages;
+
+	uint32_t next_page = 0;     // page the staging buffer goes to
+	uint32_t next_sequence = 0;
+
+	uint8_t staging[FLASH_DEVICE_PAGE_SIZE];
+	uint16_t staged = 0;        // payload bytes in staging
+
+	bool readPage(uint32_t page, uint8_t * data, uint32_t * sequence);
+	bool isBlank(uint32_t page);
+
+	public:
+		FlashLog(FlashDevice * flash);
+
+		void begin();
+		bool append(const uint8_t * record, size_t len);
+		void flush();
+		void visit(flash_log_visitor_t visitor, void * context);
+
+		uint32_t sequence();
+};
@@ -1,4 +1,10 @@
 #include "GFX.hpp"
+#include "Profiler.hpp"
+
+PROFILE_STAGE(profile_draw_string, "GFX::drawString");
+PROFILE_STAGE(profile_draw_fixed, "GFX::drawFixed");
+PROFILE_STAGE(profile_fill_rectangle, "GFX::drawFillRectangle");
+PROFILE_STAGE(profile_trend_push, "TrendGraph::push");
 
 namespace {
 
@@ -8,18 +14,35 @@ namespace {
 	    a = b;
 	    b = tmp;
 	}
-	
-};
 
+	// Longest formatted int32_t: sign, 10 digits, point and a leading zero
+	const int NumberBufferLen = 14;
 
-/**
- * Create GFX instantion 
- *
- * @param DevAddr device i2c address.
- * @param Size screen size (W128xH64 or W128xH32)
- * @param i2c i2c instance
- */
-GFX::GFX(uint16_t const DevAddr, size Size, i2c_inst_t * i2c) : SSD1306(DevAddr, Size, i2c) {};
+	/*
+	 * Format value / 10^decimals right aligned into buffer, returning the first character.
+	 * Works from the end of the buffer backwards, so no reversing and no heap.
+	 */
+	inline static char * formatFixed(char * end, int32_t value, uint8_t decimals)
+	{
+		char * p = end;
+		// Negate in unsigned so INT32_MIN does not overflow
+		uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+		int digits = 0;
+
+		do
+		{
+			if(decimals && digits == decimals) *--p = '.';
+			*--p = '0' + magnitude % 10;
+			magnitude /= 10;
+			digits++;
+		} while(magnitude || digits <= decimals);
+
+		if(value < 0) *--p = '-';
+
+		return p;
+	}
+	
+};
 
 
 /**
@@ -30,22 +53,54 @@ GFX::GFX(uint16_t const DevAddr, size Size, i2c_inst_t * i2c) : SSD1306(DevAddr,
  * @param chr char to be written
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawChar(int x, int y, char chr, colors color)
+template <class Display>
+void BasicGFX<Display>::drawChar(int x, int y, char chr, colors color)
 {
-	if(chr > 0x7E) return; // chr > '~'
+	if(chr < 0x20 || chr > 0x7E) return; // chr < ' ' || chr > '~'
+
+	const uint8_t * glyph = this->font + (chr-0x20) * (this->font)[1] + 2;
+
+	if(this->font[0] != 8)
+	{
+		for(uint8_t i=0; i < this->font[1]; i++ )
+		{
+			uint8_t line = glyph[i];
+
+			for(int8_t j=0; j<this->font[0]; j++, line >>= 1)
+			{
+				if((line & 1) && x+i >= 0 && x+i < this->getWidth() && y+j >= 0 && y+j < this->getHeight())
+				{
+					this->drawPixel(x+i, y+j, color);
+				}
+			}
+		}
+		return;
+	}
+
+	// 8 pixel high glyph columns have the same layout as a page byte, so each column is
+	// one byte write when y is page aligned, or two shifted writes straddling two pages
+	if(y <= -8 || y >= this->getHeight()) return;
+
+	const int page = y < 0 ? -1 : y / 8;
+	const int shift = y - page * 8;
+	const int pages = this->getHeight() / 8;
 
 	for(uint8_t i=0; i < this->font[1]; i++ )
 	{
-        uint8_t line = (uint8_t)(this->font)[(chr-0x20) * (this->font)[1] + i + 2];
+		const int col = x + i;
+		if(col < 0 || col >= this->getWidth()) continue;
+
+		const uint8_t line = glyph[i];
 
-        for(int8_t j=0; j<this->font[0]; j++, line >>= 1)
-        {
-            if(line & 1)
-            {
-            	this->drawPixel(x+i, y+j, color);
-            }
-        }
-    }
+		if(page >= 0)
+		{
+			this->writeMasked(page * this->getWidth() + col, page, col, (uint8_t)(line << shift), color);
+		}
+		if(shift && page + 1 < pages)
+		{
+			this->writeMasked((page + 1) * this->getWidth() + col, page + 1, col, line >> (8 - shift), color);
+		}
+	}
 }
 
 
@@ -57,19 +112,93 @@ void GFX::drawChar(int x, int y, char chr, colors color)
  * @param str string to be written
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawString(int x, int y, std::string str, colors color)
+template <class Display>
+void BasicGFX<Display>::drawString(int x, int y, std::string_view str, colors color)
 {
+	LATENCY_PROBE(profile_draw_string);
+
 	int x_tmp = x;
 
-	while(str.length())
+	for(char chr : str)
 	{
-		this->drawChar(x_tmp, y, str.front(), color);
+		this->drawChar(x_tmp, y, chr, color);
 		x_tmp += ((uint8_t)font[1]) + 1;
-		str.erase(str.begin());
 	}
 }
 
 
+/**
+ * @brief Draw null terminated string.
+ *
+ * @param x position from the left edge (0, MAX WIDTH)
+ * @param y position from the top edge (0, MAX HEIGHT)
+ * @param str string to be written
+ * @param color colors::BLACK, colors::WHITE or colors::INVERSE
+ */
+template <class Display>
+void BasicGFX<Display>::drawString(int x, int y, const char* str, colors color)
+{
+	LATENCY_PROBE(profile_draw_string);
+
+	int x_tmp = x;
+
+	for(; *str; str++)
+	{
+		this->drawChar(x_tmp, y, *str, color);
+		x_tmp += ((uint8_t)font[1]) + 1;
+	}
+}
+
+
+/**
+ * @brief Draw integer number, formatted on the stack.
+ *
+ * @param x position from the left edge (0, MAX WIDTH)
+ * @param y position from the top edge (0, MAX HEIGHT)
+ * @param value number to be written
+ * @param width field width in characters, 0 for no padding
+ * @param alignment align::LEFT or align::RIGHT within the field
+ * @param color colors::BLACK, colors::WHITE or colors::INVERSE
+ */
+template <class Display>
+void BasicGFX<Display>::drawNumber(int x, int y, int32_t value, uint8_t width, align alignment, colors color)
+{
+	this->drawFixed(x, y, value, 0, width, alignment, color);
+}
+
+
+/**
+ * @brief Draw fixed point number, e.g. value 2315 with 2 decimals is drawn as 23.15.
+ *
+ * @param x position from the left edge (0, MAX WIDTH)
+ * @param y position from the top edge (0, MAX HEIGHT)
+ * @param value number scaled by 10^decimals
+ * @param decimals number of digits after the decimal point
+ * @param width field width in characters, 0 for no padding
+ * @param alignment align::LEFT or align::RIGHT within the field
+ * @param color colors::BLACK, colors::WHITE or colors::INVERSE
+ */
+template <class Display>
+void BasicGFX<Display>::drawFixed(int x, int y, int32_t value, uint8_t decimals, uint8_t width, align alignment, colors color)
+{
+	LATENCY_PROBE(profile_draw_fixed);
+
+	if(decimals > 9) decimals = 9;
+
+	char buffer[NumberBufferLen];
+	char * end = buffer + NumberBufferLen;
+	char * str = formatFixed(end, value, decimals);
+	int len = end - str;
+
+	if(alignment == align::RIGHT && width > len)
+	{
+		x += (width - len) * (((uint8_t)font[1]) + 1);
+	}
+
+	this->drawString(x, y, std::string_view(str, len), color);
+}
+
+
 /**
  * @brief Draw empty rectangle.
  *
@@ -79,7 +208,8 @@ void GFX::drawString(int x, int y, std::string str, colors color)
  * @param h height of the rectangle
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawRectangle(int x, int y, uint16_t w, uint16_t h, colors color)
+template <class Display>
+void BasicGFX<Display>::drawRectangle(int x, int y, uint16_t w, uint16_t h, colors color)
 {
     this->drawHorizontalLine(x, y, w, color);
     this->drawHorizontalLine(x, y+h-1, w, color);
@@ -97,11 +227,30 @@ void GFX::drawRectangle(int x, int y, uint16_t w, uint16_t h, colors color)
  * @param h height of the rectangle
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawFillRectangle(int x, int y, uint16_t w, uint16_t h, colors color)
+template <class Display>
+void BasicGFX<Display>::drawFillRectangle(int x, int y, uint16_t w, uint16_t h, colors color)
 {
-    for (int i=x; i<x+w; i++) {
-    	this->drawVerticalLine(i, y, h, color);
-    }
+	LATENCY_PROBE(profile_fill_rectangle);
+
+	// Clip to the screen, the span kernels do not check bounds
+	int x_end = x + w - 1;
+	int y_end = y + h - 1;
+
+	if(x < 0) x = 0;
+	if(y < 0) y = 0;
+	if(x_end >= this->getWidth()) x_end = this->getWidth() - 1;
+	if(y_end >= this->getHeight()) y_end = this->getHeight() - 1;
+	if(x > x_end || y > y_end) return;
+
+	// One masked span per page the rectangle touches
+	for(int page = y / 8; page <= y_end / 8; page++)
+	{
+		int top = page * 8 > y ? 0 : y % 8;
+		int bottom = page * 8 + 7 < y_end ? 7 : y_end % 8;
+		uint8_t mask = (0xFF << top) & (0xFF >> (7 - bottom));
+
+		this->fillSpan(page, x, x_end, mask, color);
+	}
 }
 
 
@@ -115,7 +264,8 @@ void GFX::drawFillRectangle(int x, int y, uint16_t w, uint16_t h, colors color)
  * @param progress progress (0, 100)
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawProgressBar(int x, int y, uint16_t w, uint16_t h, uint8_t progress, colors color)
+template <class Display>
+void BasicGFX<Display>::drawProgressBar(int x, int y, uint16_t w, uint16_t h, uint8_t progress, colors color)
 {
     this->drawRectangle(x, y, w, h, color);
     this->drawFillRectangle(x, y, (uint8_t)((w*progress)/100), h, color);
@@ -130,9 +280,10 @@ void GFX::drawProgressBar(int x, int y, uint16_t w, uint16_t h, uint8_t progress
  * @param h height of the line
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawVerticalLine(int x, int y, int h, colors color)
+template <class Display>
+void BasicGFX<Display>::drawVerticalLine(int x, int y, int h, colors color)
 {
-	this->drawLine(x, y, x, y+h-1, color);
+	if(h > 0) this->drawFillRectangle(x, y, 1, h, color);
 }
 
 
@@ -144,9 +295,10 @@ void GFX::drawVerticalLine(int x, int y, int h, colors color)
  * @param w width of the line
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawHorizontalLine(int x, int y, int w, colors color)
+template <class Display>
+void BasicGFX<Display>::drawHorizontalLine(int x, int y, int w, colors color)
 {
-	this->drawLine(x, y, x+w-1, y, color);
+	if(w > 0) this->drawFillRectangle(x, y, w, 1, color);
 }
 
 
@@ -159,7 +311,8 @@ void GFX::drawHorizontalLine(int x, int y, int w, colors color)
  * @param y_end position of the second point from the top edge  (0, MAX HEIGHT)
  * @param color colors::BLACK, colors::WHITE or colors::INVERSE
  */
-void GFX::drawLine(int x_start, int y_start, int x_end, int y_end, colors color)
+template <class Display>
+void BasicGFX<Display>::drawLine(int x_start, int y_start, int x_end, int y_end, colors color)
 {
 	int16_t steep = abs(y_end - y_start) > abs(x_end - x_start);
 
@@ -213,12 +366,62 @@ void GFX::drawLine(int x_start, int y_start, int x_end, int y_end, colors color)
 }
 
 
+/**
+ * @brief Move a region of the framebuffer left, the columns freed on the right are cleared.
+ *
+ * @param x position from the left edge (0, MAX WIDTH)
+ * @param y position from the top edge (0, MAX HEIGHT)
+ * @param w width of the region
+ * @param h height of the region
+ * @param columns number of columns to move by
+ */
+template <class Display>
+void BasicGFX<Display>::scrollLeft(int x, int y, uint16_t w, uint16_t h, uint8_t columns)
+{
+	int x_end = x + w - 1;
+	int y_end = y + h - 1;
+
+	if(x < 0) x = 0;
+	if(y < 0) y = 0;
+	if(x_end >= this->getWidth()) x_end = this->getWidth() - 1;
+	if(y_end >= this->getHeight()) y_end = this->getHeight() - 1;
+	if(x > x_end || y > y_end || columns == 0) return;
+
+	const int last_kept = x_end - columns;     // last column that receives shifted data
+
+	for(int page = y / 8; page <= y_end / 8; page++)
+	{
+		int top = page * 8 > y ? 0 : y % 8;
+		int bottom = page * 8 + 7 < y_end ? 7 : y_end % 8;
+		uint8_t mask = (0xFF << top) & (0xFF >> (7 - bottom));
+		unsigned char * row = this->buffer + page * this->getWidth();
+
+		if(last_kept >= x)
+		{
+			// Whole bytes move with one memmove, a region sharing its pages needs a masked copy
+			if(mask == 0xFF) memmove(row + x, row + x + columns, last_kept - x + 1);
+			else
+			{
+				for(int col = x; col <= last_kept; col++)
+				{
+					row[col] = (row[col] & ~mask) | (row[col + columns] & mask);
+				}
+			}
+			this->markDirty(page, x, last_kept);
+		}
+
+		this->fillSpan(page, last_kept < x ? x : last_kept + 1, x_end, mask, colors::BLACK);
+	}
+}
+
+
 /**
  * @brief Set your own font
  *
  * @param font Pointer to array with your font
  */
-void GFX::setFont(const uint8_t* font)
+template <class Display>
+void BasicGFX<Display>::setFont(const uint8_t* font)
 {
 	this->font = font;
 }
@@ -229,7 +432,208 @@ void GFX::setFont(const uint8_t* font)
  *
  * @return Pointer to array with the currently used font
  */
-const uint8_t* GFX::getFont()
+template <class Display>
+const uint8_t* BasicGFX<Display>::getFont()
 {
 	return font;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Create a trend graph over a screen region, autoscaled until setRange() is called.
+ *
+ * @param gfx display to draw on
+ * @param x position from the left edge (0, MAX WIDTH)
+ * @param y position from the top edge (0, MAX HEIGHT)
+ * @param w width of the graph, also the number of values shown
+ * @param h height of the graph
+ */
+template <class Display>
+BasicTrendGraph<Display>::BasicTrendGraph(BasicGFX<Display> * gfx, int x, int y, uint16_t w, uint16_t h) : gfx(gfx), x(x), y(y), w(w), h(h)
+{
+	this->history = new int32_t[w]();
+}
+
+
+template <class Display>
+BasicTrendGraph<Display>::~BasicTrendGraph()
+{
+	delete[] this->history;
+}
+
+
+/**
+ * @brief Use a fixed range, values outside are drawn at the edge.
+ *
+ * @param low value at the bottom row
+ * @param high value at the top row
+ */
+template <class Display>
+void BasicTrendGraph<Display>::setRange(int32_t low, int32_t high)
+{
+	this->autoscale = false;
+	this->low = low;
+	this->high = high > low ? high : low + 1;
+	this->redraw();
+}
+
+
+/**
+ * @brief Let the range follow the values shown.
+ */
+template <class Display>
+void BasicTrendGraph<Display>::setAutoscale()
+{
+	this->autoscale = true;
+	if(this->fitRange()) this->redraw();
+}
+
+
+/**
+ * @brief Add a value at the right edge, scrolling the older values left.
+ *
+ * @param value value to plot
+ */
+template <class Display>
+void BasicTrendGraph<Display>::push(int32_t value)
+{
+	LATENCY_PROBE(profile_trend_push);
+
+	if(this->w == 0) return;
+
+	const bool has_previous = this->count > 0;
+	const int32_t previous = has_previous ? this->history[(this->head + this->w - 1) % this->w] : value;
+	const int32_t evicted = this->history[this->head];
+	const bool full = this->count == this->w;
+
+	this->history[this->head] = value;
+	this->head = (this->head + 1) % this->w;
+	if(!full) this->count++;
+
+	// Track the data range, a rescan is only needed when an extreme scrolls out
+	if(!has_previous)
+	{
+		this->data_min = value;
+		this->data_max = value;
+	}
+	else if(full && (evicted == this->data_min || evicted == this->data_max))
+	{
+		this->scanHistory();
+	}
+	else
+	{
+		if(value < this->data_min) this->data_min = value;
+		if(value > this->data_max) this->data_max = value;
+	}
+
+	if(this->autoscale && this->fitRange())
+	{
+		this->redraw();
+		return;
+	}
+
+	this->gfx->scrollLeft(this->x, this->y, this->w, this->h);
+	this->drawColumn(this->x + this->w - 1, previous, value, has_previous);
+
+	// The oldest value lost its left neighbour, draw it unconnected like redraw() does
+	if(full)
+	{
+		this->gfx->drawVerticalLine(this->x, this->y, this->h, colors::BLACK);
+		this->gfx->drawPixel(this->x, this->rowOf(this->history[this->head]));
+	}
+}
+
+
+/**
+ * @brief Clear the region and plot every value again.
+ */
+template <class Display>
+void BasicTrendGraph<Display>::redraw()
+{
+	this->gfx->drawFillRectangle(this->x, this->y, this->w, this->h, colors::BLACK);
+
+	const uint16_t oldest = (this->head + this->w - this->count) % this->w;
+
+	for(uint16_t i = 0; i < this->count; i++)
+	{
+		const int32_t value = this->history[(oldest + i) % this->w];
+		const int32_t previous = i ? this->history[(oldest + i - 1) % this->w] : value;
+
+		this->drawColumn(this->x + this->w - this->count + i, previous, value, i > 0);
+	}
+}
+
+
+template <class Display>
+int BasicTrendGraph<Display>::rowOf(int32_t value)
+{
+	if(value <= this->low) return this->y + this->h - 1;
+	if(value >= this->high) return this->y;
+
+	return this->y + this->h - 1 - (int)((int64_t)(value - this->low) * (this->h - 1) / (this->high - this->low));
+}
+
+
+// Vertical segment from the previous value to this one, so steps stay connected
+template <class Display>
+void BasicTrendGraph<Display>::drawColumn(int col, int32_t previous, int32_t value, bool has_previous)
+{
+	int row = this->rowOf(value);
+	int from = has_previous ? this->rowOf(previous) : row;
+
+	if(from < row) this->gfx->drawVerticalLine(col, from + 1, row - from);
+	else if(from > row) this->gfx->drawVerticalLine(col, row, from - row);
+	else this->gfx->drawPixel(col, row);
+}
+
+
+template <class Display>
+void BasicTrendGraph<Display>::scanHistory()
+{
+	this->data_min = this->data_max = this->history[0];
+
+	for(uint16_t i = 1; i < this->count; i++)
+	{
+		if(this->history[i] < this->data_min) this->data_min = this->history[i];
+		if(this->history[i] > this->data_max) this->data_max = this->history[i];
+	}
+}
+
+
+/*
+ * Choose a range around the data with an eighth of headroom on both sides. It only changes
+ * when a value falls outside or the data shrinks to under half of the range, so small
+ * fluctuations do not cause full redraws. Returns true if the range changed.
+ */
+template <class Display>
+bool BasicTrendGraph<Display>::fitRange()
+{
+	if(this->count == 0) return false;
+
+	const int64_t span = (int64_t)this->data_max - this->data_min;
+	const bool outside = this->data_min < this->low || this->data_max > this->high;
+	const bool shrunk = span * 2 < (int64_t)this->high - this->low;
+
+	if(!outside && !shrunk && this->high > this->low) return false;
+
+	const int64_t margin = span / 8 + 1;
+	const int32_t low = this->data_min - margin < INT32_MIN ? INT32_MIN : this->data_min - margin;
+	const int32_t high = this->data_max + margin > INT32_MAX ? INT32_MAX : this->data_max + margin;
+
+	if(low == this->low && high == this->high) return false;
+
+	this->low = low;
+	this->high = high;
+	return true;
+}
+
+
+// The drawing code is compiled once per display type, here
+template class BasicGFX<SSD1306>;
+template class BasicGFX<SSD1306Fixed<128, 64>>;
+template class BasicGFX<SSD1306Fixed<128, 32>>;
+template class BasicGFX<SSD1306Fixed<64, 32>>;
+
+template class BasicTrendGraph<SSD1306>;
+template class BasicTrendGraph<SSD1306Fixed<128, 64>>;
+template class BasicTrendGraph<SSD1306Fixed<128, 32>>;
+template class BasicTrendGraph<SSD1306Fixed<64, 32>>;
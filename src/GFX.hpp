@@ -6,18 +6,34 @@
 #include "SSD1306.hpp"
 #include "font.hpp"
 #include <stdlib.h>
-#include <string>
+#include <string_view>
 
 
+enum class align {
+	LEFT,
+	RIGHT
+};
+
 
-class GFX : public SSD1306 {
+/*!
+    @brief  Text and shape drawing on top of a display driver.
+            The display type is a template parameter, so with SSD1306Fixed the pixel writes
+            resolve to its compile-time geometry instead of going through the runtime class.
+            GFX is the runtime sized version.
+    @tparam Display SSD1306 or an SSD1306Fixed.
+*/
+template <class Display>
+class BasicGFX : public Display {
     const uint8_t* font = font_8x5;
 
     public:
-        GFX(uint16_t const DevAddr, size Size, i2c_inst_t * i2c);
+        using Display::Display;
 
         void drawChar(int x, int y, char chr, colors color = colors::WHITE);
-        void drawString(int x, int y, std::string str, colors color = colors::WHITE);
+        void drawString(int x, int y, std::string_view str, colors color = colors::WHITE);
+        void drawString(int x, int y, const char* str, colors color = colors::WHITE);
+        void drawNumber(int x, int y, int32_t value, uint8_t width = 0, align alignment = align::LEFT, colors color = colors::WHITE);
+        void drawFixed(int x, int y, int32_t value, uint8_t decimals, uint8_t width = 0, align alignment = align::LEFT, colors color = colors::WHITE);
         void drawProgressBar(int x, int y, uint16_t w, uint16_t h, uint8_t progress, colors color = colors::WHITE);
         void drawFillRectangle(int x, int y, uint16_t w, uint16_t h, colors color = colors::WHITE);
         void drawRectangle(int x, int y, uint16_t w, uint16_t h, colors color = colors::WHITE);
@@ -25,8 +41,66 @@ class GFX : public SSD1306 {
         void drawVerticalLine(int x, int y, int w, colors color = colors::WHITE);
         void drawLine(int x_start, int y_start, int x_end, int y_end, colors color = colors::WHITE);
 
+        void scrollLeft(int x, int y, uint16_t w, uint16_t h, uint8_t columns = 1);
+
         void setFont(const uint8_t* font);
         const uint8_t* getFont();
 };
 
+typedef BasicGFX<SSD1306> GFX;
+
+
+/*!
+    @brief  Strip chart of the most recent values, one column per value, newest on the right.
+            push() shifts the plot one column left in the framebuffer and draws only the new
+            column, so the work per value does not depend on the chart width. With autoscale the
+            range follows the data and the plot is only redrawn when the range changes.
+*/
+template <class Display>
+class BasicTrendGraph {
+    BasicGFX<Display> * gfx;
+    int x, y;
+    uint16_t w, h;
+
+    int32_t * history;      // ring of the last w values
+    uint16_t head = 0;      // next slot to write
+    uint16_t count = 0;
+
+    bool autoscale = true;
+    int32_t low = 0, high = 0;          // plotted range
+    int32_t data_min = 0, data_max = 0; // range of the values in history
+
+    int rowOf(int32_t value);
+    void drawColumn(int col, int32_t previous, int32_t value, bool has_previous);
+    void scanHistory();
+    bool fitRange();
+
+    public:
+        BasicTrendGraph(BasicGFX<Display> * gfx, int x, int y, uint16_t w, uint16_t h);
+        ~BasicTrendGraph();
+
+        // Owns history, a copy would free it twice
+        BasicTrendGraph(const BasicTrendGraph &) = delete;
+        BasicTrendGraph &operator=(const BasicTrendGraph &) = delete;
+
+        void setRange(int32_t low, int32_t high);
+        void setAutoscale();
+        void push(int32_t value);
+        void redraw();
+};
+
+typedef BasicTrendGraph<SSD1306> TrendGraph;
+
+
+// Compiled in GFX.cpp for the runtime display and every fixed geometry
+extern template class BasicGFX<SSD1306>;
+extern template class BasicGFX<SSD1306Fixed<128, 64>>;
+extern template class BasicGFX<SSD1306Fixed<128, 32>>;
+extern template class BasicGFX<SSD1306Fixed<64, 32>>;
+
+extern template class BasicTrendGraph<SSD1306>;
+extern template class BasicTrendGraph<SSD1306Fixed<128, 64>>;
+extern template class BasicTrendGraph<SSD1306Fixed<128, 32>>;
+extern template class BasicTrendGraph<SSD1306Fixed<64, 32>>;
+
 #endif
\ No newline at end of file
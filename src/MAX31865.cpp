@@ -1,18 +1,38 @@
 
 #include "MAX31865.hpp"
+#include "RtdProfile.hpp"
+#include "Profiler.hpp"
 #include "hardware/spi.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
 #include <stdlib.h>
 #include "pico/stdlib.h"
 #include <cmath>
 #include "pico/binary_info.h"
 
+PROFILE_STAGE(profile_read_rtd, "MAX31865::readRTD");
+PROFILE_STAGE(profile_calculate, "MAX31865::calculateTemperature");
+
+// Driver streaming on each GPIO, for dispatching the shared GPIO interrupt
+static MAX31865 *drdy_owners[NUM_BANK0_GPIOS];
+
+// Chips in a MAX31865Bus on each SPI instance. The DRDY interrupt reads over
+// SPI and would cut into a sweep's transfers, so no chip there may stream
+static uint8_t swept_chips[NUM_SPIS];
 
 /**************************************************************************/
 /*!
     @brief Create the interface object using hardware SPI
+    @param spi SPI instance, already initialised in mode 1 or 3
+    @param cs_pin Chip select GPIO of this chip, driven by the driver
 */
 /**************************************************************************/
-MAX31865::MAX31865(spi_inst_t *spi) {}
+MAX31865::MAX31865(spi_inst_t *spi, uint cs_pin) : spi(spi), cs_pin(cs_pin) {
+  // Chip select is active-low, so we'll initialise it to a driven-high state
+  gpio_init(cs_pin);
+  gpio_set_dir(cs_pin, GPIO_OUT);
+  gpio_put(cs_pin, 1);
+}
 
 /**************************************************************************/
 /*!
@@ -24,9 +44,11 @@ MAX31865::MAX31865(spi_inst_t *spi) {}
 /**************************************************************************/
 bool MAX31865::begin(max31865_numwires_t wires) {
 
-  setWires(wires);
-  enableBias(false);
-  autoConvert(false);
+  syncConfig();
+  // Wiring, bias off and one shot mode in a single CONFIG write
+  updateConfig(wires == MAX31865_3WIRE ? MAX31865_CONFIG_3WIRE : 0,
+               MAX31865_CONFIG_BIAS | MAX31865_CONFIG_MODEAUTO |
+                   MAX31865_CONFIG_3WIRE);
   setThresholds(0, 0xFFFF);
   clearFault();
 
@@ -35,6 +57,38 @@ bool MAX31865::begin(max31865_numwires_t wires) {
   return true;
 }
 
+/**************************************************************************/
+/*!
+    @brief Read all registers, CONFIG to FAULTSTAT, in one SPI transaction
+    @return The decoded registers
+*/
+/**************************************************************************/
+max31865_snapshot_t MAX31865::snapshot(void) {
+  uint8_t buffer[8];
+  readRegisterN(MAX31865_CONFIG_REG, buffer, sizeof(buffer));
+
+  max31865_snapshot_t s;
+  s.config = buffer[MAX31865_CONFIG_REG];
+  s.rtd = ((buffer[MAX31865_RTDMSB_REG] << 8) | buffer[MAX31865_RTDLSB_REG]) >> 1;
+  s.fault = buffer[MAX31865_RTDLSB_REG] & 1;
+  s.upperThreshold =
+      (buffer[MAX31865_HFAULTMSB_REG] << 8) | buffer[MAX31865_HFAULTLSB_REG];
+  s.lowerThreshold =
+      (buffer[MAX31865_LFAULTMSB_REG] << 8) | buffer[MAX31865_LFAULTLSB_REG];
+  s.faultStatus = buffer[MAX31865_FAULTSTAT_REG];
+
+  return s;
+}
+
+/**************************************************************************/
+/*!
+    @brief Registers read at the end of the last one shot conversion, so the
+    fault state of a sample needs no extra bus transfer
+    @return The decoded registers
+*/
+/**************************************************************************/
+const max31865_snapshot_t &MAX31865::lastSnapshot(void) { return _snapshot; }
+
 /**************************************************************************/
 /*!
     @brief Read the raw 8-bit FAULTSTAT register
@@ -51,12 +105,44 @@ uint8_t MAX31865::readFault(void) {
 */
 /**************************************************************************/
 void MAX31865::clearFault(void) {
-  uint8_t t = readRegister8(MAX31865_CONFIG_REG);
-  t &= ~0x2C;
-  t |= MAX31865_CONFIG_FAULTSTAT;
-  writeRegister8(MAX31865_CONFIG_REG, t);
+  writeConfig(MAX31865_CONFIG_FAULTSTAT);
+}
+
+/**************************************************************************/
+/*!
+    @brief Reload the cached copy of the CONFIG register from the chip.
+    Setters only write the register, so call this if something else may
+    have changed it
+    @return The CONFIG register
+*/
+/**************************************************************************/
+uint8_t MAX31865::syncConfig(void) {
+  _config = readRegister8(MAX31865_CONFIG_REG) & ~MAX31865_CONFIG_SELFCLEAR;
+  return _config;
 }
 
+/**************************************************************************/
+/*!
+    @brief Apply several CONFIG changes in a single register write
+    @param set Bits to set, e.g. MAX31865_CONFIG_BIAS. Self clearing bits,
+    e.g. MAX31865_CONFIG_FAULTSTAT, are written once and not cached
+    @param clear Bits to clear
+*/
+/**************************************************************************/
+void MAX31865::updateConfig(uint8_t set, uint8_t clear) {
+  _config = (_config & ~clear) | set;
+  _config &= ~MAX31865_CONFIG_SELFCLEAR;
+  writeConfig(set & MAX31865_CONFIG_SELFCLEAR);
+}
+
+/**************************************************************************/
+/*!
+    @brief Cached copy of the CONFIG register
+    @return The CONFIG register, without the self clearing bits
+*/
+/**************************************************************************/
+uint8_t MAX31865::config(void) { return _config; }
+
 /**************************************************************************/
 /*!
     @brief Enable the bias voltage on the RTD sensor
@@ -64,13 +150,11 @@ void MAX31865::clearFault(void) {
 */
 /**************************************************************************/
 void MAX31865::enableBias(bool b) {
-  uint8_t t = readRegister8(MAX31865_CONFIG_REG);
   if (b) {
-    t |= MAX31865_CONFIG_BIAS; // enable bias
+    updateConfig(MAX31865_CONFIG_BIAS, 0); // enable bias
   } else {
-    t &= ~MAX31865_CONFIG_BIAS; // disable bias
+    updateConfig(0, MAX31865_CONFIG_BIAS); // disable bias
   }
-  writeRegister8(MAX31865_CONFIG_REG, t);
 }
 
 /**************************************************************************/
@@ -80,13 +164,11 @@ void MAX31865::enableBias(bool b) {
 */
 /**************************************************************************/
 void MAX31865::autoConvert(bool b) {
-  uint8_t t = readRegister8(MAX31865_CONFIG_REG);
   if (b) {
-    t |= MAX31865_CONFIG_MODEAUTO; // enable autoconvert
+    updateConfig(MAX31865_CONFIG_MODEAUTO, 0); // enable autoconvert
   } else {
-    t &= ~MAX31865_CONFIG_MODEAUTO; // disable autoconvert
+    updateConfig(0, MAX31865_CONFIG_MODEAUTO); // disable autoconvert
   }
-  writeRegister8(MAX31865_CONFIG_REG, t);
 }
 
 /**************************************************************************/
@@ -97,13 +179,11 @@ void MAX31865::autoConvert(bool b) {
 /**************************************************************************/
 
 void MAX31865::enable50Hz(bool b) {
-  uint8_t t = readRegister8(MAX31865_CONFIG_REG);
   if (b) {
-    t |= MAX31865_CONFIG_FILT50HZ;
+    updateConfig(MAX31865_CONFIG_FILT50HZ, 0);
   } else {
-    t &= ~MAX31865_CONFIG_FILT50HZ;
+    updateConfig(0, MAX31865_CONFIG_FILT50HZ);
   }
-  writeRegister8(MAX31865_CONFIG_REG, t);
 }
 
 /**************************************************************************/
@@ -149,14 +229,12 @@ uint16_t MAX31865::getUpperThreshold(void) {
 */
 /**************************************************************************/
 void MAX31865::setWires(max31865_numwires_t wires) {
-  uint8_t t = readRegister8(MAX31865_CONFIG_REG);
   if (wires == MAX31865_3WIRE) {
-    t |= MAX31865_CONFIG_3WIRE;
+    updateConfig(MAX31865_CONFIG_3WIRE, 0);
   } else {
     // 2 or 4 wire
-    t &= ~MAX31865_CONFIG_3WIRE;
+    updateConfig(0, MAX31865_CONFIG_3WIRE);
   }
-  writeRegister8(MAX31865_CONFIG_REG, t);
 }
 
 /**************************************************************************/
@@ -175,6 +253,18 @@ void MAX31865::setWires(max31865_numwires_t wires) {
 float MAX31865::temperature(float RTDnominal, float refResistor) {
   return calculateTemperature(readRTD(), RTDnominal, refResistor);
 }
+
+/**************************************************************************/
+/*!
+    @brief Read the temperature in C from the RTD using a precomputed
+    conversion profile
+    @param profile Conversion constants of the attached sensor
+    @returns Temperature in C
+*/
+/**************************************************************************/
+float MAX31865::temperature(const RtdProfile &profile) {
+  return profile.temperature(readRTD());
+}
 /**************************************************************************/
 /*!
     @brief Calculate the temperature in C from the RTD through calculation of
@@ -191,6 +281,8 @@ float MAX31865::temperature(float RTDnominal, float refResistor) {
 /**************************************************************************/
 float MAX31865::calculateTemperature(uint16_t RTDraw, float RTDnominal,
                                               float refResistor) {
+  LATENCY_PROBE(profile_calculate);
+
   float Z1, Z2, Z3, Z4, Rt, temp;
 
   Rt = RTDraw;
@@ -232,45 +324,267 @@ float MAX31865::calculateTemperature(uint16_t RTDraw, float RTDnominal,
 
 /**************************************************************************/
 /*!
-    @brief Read the raw 16-bit value from the RTD_REG in one shot mode
+    @brief Read the raw 16-bit value from the RTD_REG in one shot mode.
+    Blocks for the bias settling and conversion time, see startConversion()
+    for the non-blocking version
     @return The raw unsigned 16-bit value, NOT temperature!
 */
 /**************************************************************************/
 uint16_t MAX31865::readRTD(void) {
-  clearFault();
-  enableBias(true);
-  sleep_ms(10);
-  uint8_t t = readRegister8(MAX31865_CONFIG_REG);
-  t |= MAX31865_CONFIG_1SHOT;
-  writeRegister8(MAX31865_CONFIG_REG, t);
-  sleep_ms(65);
+  LATENCY_PROBE(profile_read_rtd);
+
+  startConversion();
+  while (!poll()) {
+    sleep_until(_deadline);
+  }
+
+  return result();
+}
+
+/**************************************************************************/
+/*!
+    @brief Start a one shot conversion without blocking. Enables the bias,
+    then poll() triggers the conversion once the bias has settled and reads
+    the result once the conversion is done
+*/
+/**************************************************************************/
+void MAX31865::startConversion(void) {
+  // Enable the bias and clear faults in one write
+  _config |= MAX31865_CONFIG_BIAS;
+  writeConfig(MAX31865_CONFIG_FAULTSTAT);
+
+  _deadline = make_timeout_time_ms(MAX31865_BIAS_SETTLE_MS);
+  _state = MAX31865_BIAS_SETTLING;
+}
+
+/**************************************************************************/
+/*!
+    @brief Advance a conversion started by startConversion(). Cheap to call
+    often, it only touches the bus when the current step's deadline passed.
+    Calls the callback, if set, when the result becomes available
+    @return True once the result is available
+*/
+/**************************************************************************/
+bool MAX31865::poll(void) {
+  switch (_state) {
+  case MAX31865_BIAS_SETTLING:
+    if (!time_reached(_deadline))
+      return false;
+
+    writeConfig(MAX31865_CONFIG_1SHOT);
+    _deadline = make_timeout_time_ms(MAX31865_CONVERSION_MS);
+    _state = MAX31865_CONVERTING;
+    return false;
+
+  case MAX31865_CONVERTING:
+    if (!time_reached(_deadline))
+      return false;
+
+    // Result and fault status in one transfer
+    _snapshot = snapshot();
+    _rtd = _snapshot.rtd;
+
+    enableBias(false); // Disable bias current again to reduce selfheating.
+
+    _state = MAX31865_DONE;
+    if (_callback)
+      _callback(_rtd, _context);
+    return true;
+
+  case MAX31865_DONE:
+    return true;
+
+  default:
+    return false;
+  }
+}
 
+/**************************************************************************/
+/*!
+    @brief Result of the last completed conversion
+    @return The raw unsigned 16-bit value, NOT temperature!
+*/
+/**************************************************************************/
+uint16_t MAX31865::result(void) { return _rtd; }
+
+/**************************************************************************/
+/*!
+    @brief Current step of the one shot conversion
+    @return MAX31865_IDLE, MAX31865_BIAS_SETTLING, MAX31865_CONVERTING or
+    MAX31865_DONE
+*/
+/**************************************************************************/
+max31865_state_t MAX31865::state(void) { return _state; }
+
+/**************************************************************************/
+/*!
+    @brief Time at which the current step of the conversion ends, so callers
+    can sleep until then instead of spinning on poll()
+    @return Deadline of the current step
+*/
+/**************************************************************************/
+absolute_time_t MAX31865::deadline(void) { return _deadline; }
+
+/**************************************************************************/
+/*!
+    @brief Set a function to call from poll() when a conversion completes
+    @param callback Function taking the raw RTD value and context, or nullptr
+    @param context Passed through to callback
+*/
+/**************************************************************************/
+void MAX31865::setCallback(max31865_callback_t callback, void *context) {
+  _callback = callback;
+  _context = context;
+}
+
+/**************************************************************************/
+/*!
+    @brief Convert continuously at the 50/60 Hz filter rate and collect every
+    result in a ring buffer. Bias and auto conversion are enabled with one
+    CONFIG write, and the RTD register is read from the DRDY falling edge
+    interrupt. The first result is converted while the bias settles and is
+    dropped. Use drainSamples() to fetch results; do not use other register
+    accesses on this chip, or other transfers on its SPI instance, until
+    stopStreaming(). Chips of a MAX31865Bus cannot stream, nor can any chip
+    sharing the SPI instance of one, the interrupt would cut into a sweep
+    @param drdy_pin GPIO the DRDY output is connected to
+    @return False if drdy_pin is no GPIO or already streaming, this chip is
+    already streaming, or a MAX31865Bus uses the SPI instance
+*/
+/**************************************************************************/
+bool MAX31865::startStreaming(uint drdy_pin) {
+  if (drdy_pin >= NUM_BANK0_GPIOS || drdy_owners[drdy_pin] || _drdy_pin >= 0 ||
+      swept_chips[spi_get_index(spi)])
+    return false;
+
+  uint16_t stale;
+  while (_samples.pop(stale)) {
+  }
+  _dropped = _faulted = 0;
+  _settling = true;
+  _drdy_pin = drdy_pin;
+  drdy_owners[drdy_pin] = this;
+
+  updateConfig(MAX31865_CONFIG_BIAS | MAX31865_CONFIG_MODEAUTO |
+                   MAX31865_CONFIG_FAULTSTAT,
+               0);
+
+  gpio_init(drdy_pin);
+  gpio_set_dir(drdy_pin, GPIO_IN);
+  gpio_pull_up(drdy_pin);
+  gpio_set_irq_enabled_with_callback(drdy_pin, GPIO_IRQ_EDGE_FALL, true,
+                                     &MAX31865::drdyIrq);
+
+  // An unread result, e.g. of a conversion that finished after the last
+  // stopStreaming(), holds DRDY low and no falling edge would ever come.
+  // Read it now the interrupt is armed, it predates this stream so drop it
+  uint32_t ints = save_and_disable_interrupts();
+  if (!gpio_get(drdy_pin))
+    readRegister16(MAX31865_RTDMSB_REG);
+  restore_interrupts(ints);
+
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Stop streaming, switching auto conversion and bias off again
+*/
+/**************************************************************************/
+void MAX31865::stopStreaming(void) {
+  if (_drdy_pin < 0)
+    return;
+
+  gpio_set_irq_enabled(_drdy_pin, GPIO_IRQ_EDGE_FALL, false);
+  drdy_owners[_drdy_pin] = nullptr;
+  _drdy_pin = -1;
+
+  updateConfig(0, MAX31865_CONFIG_BIAS | MAX31865_CONFIG_MODEAUTO);
+
+  // Release DRDY if a result came in after the interrupt was disabled
+  readRegister16(MAX31865_RTDMSB_REG);
+}
+
+/**************************************************************************/
+/*!
+    @brief Move streamed samples out of the ring buffer, oldest first
+    @param samples Buffer receiving the raw RTD values, as returned by
+    readRTD()
+    @param max Capacity of samples
+    @return Number of samples copied
+*/
+/**************************************************************************/
+size_t MAX31865::drainSamples(uint16_t samples[], size_t max) {
+  return _samples.pop(samples, max);
+}
+
+/**************************************************************************/
+/*!
+    @brief Samples lost because the ring buffer was full
+    @return Count since startStreaming()
+*/
+/**************************************************************************/
+uint32_t MAX31865::droppedSamples(void) { return _dropped; }
+
+/**************************************************************************/
+/*!
+    @brief Samples read with the fault bit set, see readFault()
+    @return Count since startStreaming()
+*/
+/**************************************************************************/
+uint32_t MAX31865::faultedSamples(void) { return _faulted; }
+
+void MAX31865::drdyIrq(uint gpio, uint32_t events) {
+  (void)events; // only falling edges are enabled
+
+  if (gpio < NUM_BANK0_GPIOS && drdy_owners[gpio])
+    drdy_owners[gpio]->onDataReady();
+}
+
+void MAX31865::onDataReady(void) {
   uint16_t rtd = readRegister16(MAX31865_RTDMSB_REG);
 
-  enableBias(false); // Disable bias current again to reduce selfheating.
+  if (_settling) {
+    _settling = false;
+    return;
+  }
 
-  // remove fault
-  rtd >>= 1;
+  if (rtd & 1)
+    _faulted++;
 
-  return rtd;
+  if (!_samples.push(rtd >> 1))
+    _dropped++;
 }
 
+bool MAX31865::joinSweep(void) {
+  if (_drdy_pin >= 0)
+    return false;
+
+  for (uint pin = 0; pin < NUM_BANK0_GPIOS; pin++) {
+    if (drdy_owners[pin] && drdy_owners[pin]->spi == spi)
+      return false;
+  }
+
+  swept_chips[spi_get_index(spi)]++;
+  return true;
+}
+
+void MAX31865::leaveSweep(void) { swept_chips[spi_get_index(spi)]--; }
+
 /**********************************************/
 
 uint8_t MAX31865::readRegister8(uint8_t addr) {
   uint8_t ret = 0;
-  addr &= 0x7F; // make sure top bit is not set
 
-  spi_write_read_blocking(spi, &addr, &ret, 1);
+  readRegisterN(addr, &ret, 1);
 
   return ret;
 }
 
 uint16_t MAX31865::readRegister16(uint8_t addr) {
   uint8_t buffer[2] = {0, 0};
-  addr &= 0x7F; // make sure top bit is not set
 
-  spi_write_read_blocking(spi, &addr, buffer, 2);
+  readRegisterN(addr, buffer, 2);
 
   uint16_t ret = buffer[0];
   ret <<= 8;
@@ -282,12 +596,36 @@ uint16_t MAX31865::readRegister16(uint8_t addr) {
 void MAX31865::readRegisterN(uint8_t addr, uint8_t buffer[],
                                       uint8_t n) {
   addr &= 0x7F; // make sure top bit is not set
-  spi_write_read_blocking(spi, &addr, buffer, n);
+
+  // Send the address, then clock the registers out. The address auto
+  // increments, so n registers are read in one transaction
+  csSelect();
+  spi_write_blocking(spi, &addr, 1);
+  spi_read_blocking(spi, 0, buffer, n);
+  csDeselect();
+}
+
+void MAX31865::writeConfig(uint8_t pulse) {
+  writeRegister8(MAX31865_CONFIG_REG, _config | pulse);
 }
 
 void MAX31865::writeRegister8(uint8_t addr, uint8_t data) {
   addr |= 0x80; // make sure top bit is set
 
   uint8_t buffer[2] = {addr, data};
+  csSelect();
   spi_write_blocking(spi, buffer, 2);
-}
\ No newline at end of file
+  csDeselect();
+}
+
+void MAX31865::csSelect(void) {
+  asm volatile("nop \n nop \n nop");
+  gpio_put(cs_pin, 0); // Active low
+  asm volatile("nop \n nop \n nop");
+}
+
+void MAX31865::csDeselect(void) {
+  asm volatile("nop \n nop \n nop");
+  gpio_put(cs_pin, 1);
+  asm volatile("nop \n nop \n nop");
+}
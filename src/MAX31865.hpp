@@ -11,6 +11,10 @@
 #define MAX31865_CONFIG_FAULTSTAT 0x02
 #define MAX31865_CONFIG_FILT50HZ 0x01
 #define MAX31865_CONFIG_FILT60HZ 0x00
+#define MAX31865_CONFIG_FAULTCYCLE 0x0C
+// Bits the chip clears by itself, never kept in the cached config
+#define MAX31865_CONFIG_SELFCLEAR                                              \
+  (MAX31865_CONFIG_1SHOT | MAX31865_CONFIG_FAULTCYCLE | MAX31865_CONFIG_FAULTSTAT)
 
 #define MAX31865_RTDMSB_REG 0x01
 #define MAX31865_RTDLSB_REG 0x02
@@ -27,10 +31,19 @@
 #define MAX31865_FAULT_RTDINLOW 0x08
 #define MAX31865_FAULT_OVUV 0x04
 
+#define MAX31865_BIAS_SETTLE_MS 10
+#define MAX31865_CONVERSION_MS 65
+#define MAX31865_STREAM_DEPTH 64
+
 #define RTD_A 3.9083e-3
 #define RTD_B -5.775e-7
+#define RTD_C -4.183e-12
 
 #include "hardware/spi.h"
+#include "pico/time.h"
+#include "SPSCQueue.hpp"
+
+class RtdProfile;
 
 typedef enum max31865_numwires {
   MAX31865_2WIRE = 0,
@@ -38,39 +51,108 @@ typedef enum max31865_numwires {
   MAX31865_4WIRE = 0
 } max31865_numwires_t;
 
+typedef enum max31865_state {
+  MAX31865_IDLE,
+  MAX31865_BIAS_SETTLING,
+  MAX31865_CONVERTING,
+  MAX31865_DONE
+} max31865_state_t;
+
+typedef void (*max31865_callback_t)(uint16_t rtd, void *context);
+
+typedef struct max31865_snapshot {
+  uint8_t config;
+  uint16_t rtd; // raw value as returned by readRTD()
+  bool fault;   // fault bit of the RTD register
+  uint16_t upperThreshold;
+  uint16_t lowerThreshold;
+  uint8_t faultStatus;
+} max31865_snapshot_t;
+
 /*! Interface class for the MAX31865 RTD Sensor reader */
 class MAX31865 {
 public:
-  MAX31865(spi_inst_t *spi);
+  MAX31865(spi_inst_t *spi, uint cs_pin);
 
   bool begin(max31865_numwires_t x = MAX31865_2WIRE);
 
+  max31865_snapshot_t snapshot(void);
+  const max31865_snapshot_t &lastSnapshot(void);
+
   uint8_t readFault(void);
   void clearFault(void);
   uint16_t readRTD();
 
+  void startConversion(void);
+  bool poll(void);
+  uint16_t result(void);
+  max31865_state_t state(void);
+  absolute_time_t deadline(void);
+  void setCallback(max31865_callback_t callback, void *context);
+
+  bool startStreaming(uint drdy_pin);
+  void stopStreaming(void);
+  size_t drainSamples(uint16_t samples[], size_t max);
+  uint32_t droppedSamples(void);
+  uint32_t faultedSamples(void);
+
   void setThresholds(uint16_t lower, uint16_t upper);
   uint16_t getLowerThreshold(void);
   uint16_t getUpperThreshold(void);
 
+  uint8_t syncConfig(void);
+  void updateConfig(uint8_t set, uint8_t clear);
+  uint8_t config(void);
+
   void setWires(max31865_numwires_t wires);
   void autoConvert(bool b);
   void enable50Hz(bool b);
   void enableBias(bool b);
 
   float temperature(float RTDnominal, float refResistor);
+  float temperature(const RtdProfile &profile);
   float calculateTemperature(uint16_t RTDraw, float RTDnominal,
                              float refResistor);
 
 private:
   spi_inst_t *spi;
+  uint cs_pin;
+
+  // Cached CONFIG register, so setters do not need a read before each write
+  uint8_t _config = 0;
+
+  max31865_state_t _state = MAX31865_IDLE;
+  absolute_time_t _deadline;
+  uint16_t _rtd = 0;
+  max31865_snapshot_t _snapshot = {};
+  max31865_callback_t _callback = nullptr;
+  void *_context = nullptr;
+
+  // Streaming ring buffer, written from the DRDY interrupt, drained by the caller
+  SPSCQueue<uint16_t, MAX31865_STREAM_DEPTH> _samples;
+  volatile uint32_t _dropped = 0;
+  volatile uint32_t _faulted = 0;
+  int _drdy_pin = -1;
+  volatile bool _settling = false; // first result of a stream, bias not settled
+
+  static void drdyIrq(uint gpio, uint32_t events);
+  void onDataReady(void);
+
+  // Chips in a MAX31865Bus share their SPI instance with its sweeps
+  friend class MAX31865Bus;
+  bool joinSweep(void);
+  void leaveSweep(void);
 
   void readRegisterN(uint8_t addr, uint8_t buffer[], uint8_t n);
 
   uint8_t readRegister8(uint8_t addr);
   uint16_t readRegister16(uint8_t addr);
 
+  void writeConfig(uint8_t pulse = 0);
   void writeRegister8(uint8_t addr, uint8_t reg);
+
+  void csSelect(void);
+  void csDeselect(void);
 };
 
 #endif
\ No newline at end of file
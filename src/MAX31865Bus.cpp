@@ -0,0 +1,128 @@
+#include "MAX31865Bus.hpp"
+#include "pico/stdlib.h"
+
+/**************************************************************************/
+/*!
+    @brief Create an empty bus, add the chips with add()
+*/
+/**************************************************************************/
+MAX31865Bus::MAX31865Bus() {}
+
+/**************************************************************************/
+/*!
+    @brief Release the chips, their SPI instances can stream again
+*/
+/**************************************************************************/
+MAX31865Bus::~MAX31865Bus() {
+  for (size_t i = 0; i < count; i++) {
+    devices[i]->leaveSweep();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Add a chip to the bus. Each chip needs its own chip select pin
+    @param device Driver of the chip, must outlive the bus
+    @return False if the bus is full, or a chip on the same SPI instance is
+    streaming
+*/
+/**************************************************************************/
+bool MAX31865Bus::add(MAX31865 &device) {
+  if (count >= MAX31865_BUS_MAX_DEVICES || !device.joinSweep())
+    return false;
+
+  devices[count++] = &device;
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Number of chips on the bus
+    @return Channel count
+*/
+/**************************************************************************/
+size_t MAX31865Bus::size(void) { return count; }
+
+/**************************************************************************/
+/*!
+    @brief Driver of one channel
+    @param channel Index in the order the chips were added
+    @return The driver
+*/
+/**************************************************************************/
+MAX31865 &MAX31865Bus::operator[](size_t channel) { return *devices[channel]; }
+
+/**************************************************************************/
+/*!
+    @brief Initialize all chips with the same number of RTD wires
+    @param wires The number of wires in enum format
+    @return True if all chips initialized
+*/
+/**************************************************************************/
+bool MAX31865Bus::begin(max31865_numwires_t wires) {
+  bool ok = true;
+
+  for (size_t i = 0; i < count; i++) {
+    ok &= devices[i]->begin(wires);
+  }
+
+  return ok;
+}
+
+/**************************************************************************/
+/*!
+    @brief Start a one-shot conversion on every chip, back to back
+*/
+/**************************************************************************/
+void MAX31865Bus::startSweep(void) {
+  for (size_t i = 0; i < count; i++) {
+    devices[i]->startConversion();
+  }
+}
+
+/**************************************************************************/
+/*!
+    @brief Advance the conversions started by startSweep() without blocking
+    @return True once every chip has its result
+*/
+/**************************************************************************/
+bool MAX31865Bus::pollSweep(void) {
+  bool done = true;
+
+  for (size_t i = 0; i < count; i++) {
+    done &= devices[i]->poll();
+  }
+
+  return done;
+}
+
+/**************************************************************************/
+/*!
+    @brief Convert all channels, blocking for a single bias settling and
+    conversion window
+    @param results Buffer receiving one raw RTD value per channel, as
+    returned by MAX31865::readRTD()
+    @return Number of results
+*/
+/**************************************************************************/
+size_t MAX31865Bus::sweep(uint16_t results[]) {
+  startSweep();
+
+  while (!pollSweep()) {
+    // Sleep until the earliest pending step of any chip
+    absolute_time_t next = at_the_end_of_time;
+    for (size_t i = 0; i < count; i++) {
+      if (devices[i]->state() != MAX31865_DONE &&
+          absolute_time_diff_us(devices[i]->deadline(), next) > 0) {
+        next = devices[i]->deadline();
+      }
+    }
+    sleep_until(next);
+  }
+
+  for (size_t i = 0; i < count; i++) {
+    results[i] = devices[i]->result();
+  }
+
+  return count;
+}
@@ -0,0 +1,32 @@
+#ifndef MAX31865BUS_H
+#define MAX31865BUS_H
+
+#include "MAX31865.hpp"
+
+#define MAX31865_BUS_MAX_DEVICES 16
+
+/*! Several MAX31865 sharing one SPI bus, converted together. A sweep starts
+    a one-shot conversion on every chip back to back and waits for the bias
+    settling and conversion windows once for all of them, so N channels take
+    about as long as one. While a chip is on a bus, no chip on the same SPI
+    instance can stream, see MAX31865::startStreaming() */
+class MAX31865Bus {
+public:
+  MAX31865Bus();
+  ~MAX31865Bus();
+
+  bool add(MAX31865 &device);
+  size_t size(void);
+  MAX31865 &operator[](size_t channel);
+
+  bool begin(max31865_numwires_t wires = MAX31865_2WIRE);
+  void startSweep(void);
+  bool pollSweep(void);
+  size_t sweep(uint16_t results[]);
+
+private:
+  MAX31865 *devices[MAX31865_BUS_MAX_DEVICES];
+  size_t count = 0;
+};
+
+#endif
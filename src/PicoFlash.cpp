@@ -0,0 +1,92 @@
+#include "FlashDevice.hpp"
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#include <string.h>
+
+static_assert(FLASH_DEVICE_PAGE_SIZE == FLASH_PAGE_SIZE, "page size mismatch");
+static_assert(FLASH_DEVICE_SECTOR_SIZE == FLASH_SECTOR_SIZE, "sector size mismatch");
+
+extern char __flash_binary_end;
+
+namespace {
+
+	/*
+	 * Flash is unreadable while it is erased or programmed, so nothing may run from
+	 * XIP meanwhile: no interrupts here, and core 1 parked if it allows it.
+	 * Parking core 1 stalls sampling for the whole operation, up to a sector erase
+	 * (tens of ms, a few hundred at worst) or a page program (about a ms).
+	 */
+	class FlashGuard {
+		uint32_t ints;
+		bool lockout;
+
+		public:
+			FlashGuard()
+			{
+				lockout = multicore_lockout_victim_is_initialized(1);
+				if(lockout) multicore_lockout_start_blocking();
+				ints = save_and_disable_interrupts();
+			}
+
+			~FlashGuard()
+			{
+				restore_interrupts(ints);
+				if(lockout) multicore_lockout_end_blocking();
+			}
+	};
+
+};
+
+
+/*!
+    @brief  Reserve the last sectors of flash.
+    @param  sectors
+            Number of 4 KB sectors, must not overlap the firmware image.
+    @return PicoFlash object.
+*/
+PicoFlash::PicoFlash(uint32_t sectors) : length(sectors * FLASH_SECTOR_SIZE)
+{
+	this->base = PICO_FLASH_SIZE_BYTES - this->length;
+
+	hard_assert((uintptr_t)&__flash_binary_end - XIP_BASE <= this->base);
+}
+
+
+/*!
+ * @brief Read from the region through the XIP window.
+ */
+void PicoFlash::read(uint32_t offset, uint8_t * data, size_t len)
+{
+	memcpy(data, (const uint8_t *)(XIP_BASE + this->base + offset), len);
+}
+
+
+/*!
+ * @brief Erase the sector starting at offset.
+ */
+void PicoFlash::eraseSector(uint32_t offset)
+{
+	FlashGuard guard;
+	flash_range_erase(this->base + offset, FLASH_SECTOR_SIZE);
+}
+
+
+/*!
+ * @brief Program the page starting at offset.
+ */
+void PicoFlash::programPage(uint32_t offset, const uint8_t * data)
+{
+	FlashGuard guard;
+	flash_range_program(this->base + offset, data, FLASH_PAGE_SIZE);
+}
+
+
+/*!
+ * @brief Region size in bytes.
+ */
+uint32_t PicoFlash::size()
+{
+	return this->length;
+}
@@ -0,0 +1,103 @@
+#include "Profiler.hpp"
+
+#ifdef PICO_LOGGER_PROFILE
+
+#include <stdio.h>
+
+LatencyStage * Profiler::first = nullptr;
+LatencyStage * Profiler::last = nullptr;
+
+
+/*!
+    @brief  Register a stage, only from static initialisation (PROFILE_STAGE) so no lock is needed.
+    @param  name
+            Label in the dump.
+    @return LatencyStage object.
+*/
+LatencyStage::LatencyStage(const char * name) : name(name), next(nullptr)
+{
+	if(Profiler::last) Profiler::last->next = this;
+	else Profiler::first = this;
+	Profiler::last = this;
+}
+
+
+/*!
+ * @brief Latency below which percent of the samples fall.
+ * @param percent 0 to 100
+ * @return microseconds, 0 without samples
+ */
+uint32_t LatencyStage::percentile(uint8_t percent) const
+{
+	const uint32_t count = this->count;
+	if(count == 0) return 0;
+
+	// Rank of the sample, counted from 1
+	uint32_t rank = ((uint64_t)count * percent + 99) / 100;
+	if(rank == 0) rank = 1;
+
+	uint32_t below = 0;
+	for(uint8_t b = 0; b < PROFILE_BUCKETS; b++)
+	{
+		const uint32_t n = this->buckets[b];
+		if(below + n < rank)
+		{
+			below += n;
+			continue;
+		}
+
+		if(b == 0) return 0;
+
+		const uint32_t low = 1u << (b - 1);
+		const uint32_t width = low;                 // bucket b spans [low, 2 * low)
+		uint32_t value = low + (uint64_t)width * (rank - below - 1) / n;
+
+		if(value < this->min) value = this->min;
+		if(value > this->max) value = this->max;
+		return value;
+	}
+
+	return this->max;
+}
+
+
+/*!
+ * @brief Forget all samples.
+ */
+void LatencyStage::reset()
+{
+	this->count = 0;
+	this->min = 0;
+	this->max = 0;
+	this->total = 0;
+	for(uint8_t b = 0; b < PROFILE_BUCKETS; b++) this->buckets[b] = 0;
+}
+
+
+/*!
+ * @brief Print a table of all stages on stdio: count, min, mean, p50, p99 and max in microseconds.
+ */
+void Profiler::dump()
+{
+	printf("%-30s %8s %8s %8s %8s %8s %8s\n", "stage (us)", "count", "min", "mean", "p50", "p99", "max");
+
+	for(LatencyStage * s = Profiler::first; s; s = s->next)
+	{
+		const uint32_t count = s->count;
+
+		printf("%-30s %8lu %8lu %8lu %8lu %8lu %8lu\n", s->name, (unsigned long)count, (unsigned long)s->min,
+			(unsigned long)(count ? s->total / count : 0), (unsigned long)s->percentile(50),
+			(unsigned long)s->percentile(99), (unsigned long)s->max);
+	}
+}
+
+
+/*!
+ * @brief Forget the samples of all stages.
+ */
+void Profiler::reset()
+{
+	for(LatencyStage * s = Profiler::first; s; s = s->next) s->reset();
+}
+
+#endif
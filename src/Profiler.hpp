@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Scoped latency probes, compiled in with PICO_LOGGER_PROFILE (cmake -DPICO_LOGGER_PROFILE=ON).
+ *
+ *   PROFILE_STAGE(profile_display, "display");     // once, at file scope
+ *
+ *   void SSD1306::display(...)
+ *   {
+ *       LATENCY_PROBE(profile_display);            // times the rest of the scope
+ *       ...
+ *   }
+ *
+ * Without PICO_LOGGER_PROFILE both macros expand to nothing and Profiler::dump() is empty.
+ */
+
+#define PROFILE_BUCKETS 33
+
+#ifdef PICO_LOGGER_PROFILE
+
+#include "pico/time.h"
+
+/*!
+    @brief  Latency histogram of one stage, in microseconds.
+            Bucket 0 counts 0 us, bucket b the range [2^(b-1), 2^b), so the histogram covers the
+            whole 32 bit range at a fixed 132 bytes. Percentiles interpolate inside the bucket.
+            A stage should be recorded by one core only. Dumping from the other core may read a
+            sample half added, which is fine for diagnostics.
+*/
+class LatencyStage {
+	const char * name;
+	LatencyStage * next;
+
+	uint32_t count = 0;
+	uint32_t min = 0;
+	uint32_t max = 0;
+	uint64_t total = 0;
+	uint32_t buckets[PROFILE_BUCKETS] = {};
+
+	friend class Profiler;
+
+	public:
+		LatencyStage(const char * name);
+
+		inline void record(uint32_t us)
+		{
+			if(this->count == 0 || us < this->min) this->min = us;
+			if(this->count == 0 || us > this->max) this->max = us;
+			this->total += us;
+			this->count++;
+			this->buckets[us ? 32 - __builtin_clz(us) : 0]++;
+		}
+
+		uint32_t percentile(uint8_t percent) const;
+		void reset();
+};
+
+
+/*!
+    @brief  Records the time from construction to the end of the scope into a stage.
+*/
+class LatencyProbe {
+	LatencyStage &stage;
+	uint32_t start;
+
+	public:
+		inline LatencyProbe(LatencyStage &stage) : stage(stage), start(time_us_32()) {}
+		inline ~LatencyProbe() { this->stage.record(time_us_32() - this->start); }
+};
+
+
+/*!
+    @brief  All stages of the program, in order of definition.
+*/
+class Profiler {
+	static LatencyStage * first;
+	static LatencyStage * last;
+
+	friend class LatencyStage;
+
+	public:
+		static void dump();
+		static void reset();
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_STAGE(id, label) static LatencyStage id(label)
+#define LATENCY_PROBE(id) LatencyProbe PROFILE_CONCAT(latency_probe_, __LINE__)(id)
+
+#else
+
+class Profiler {
+	public:
+		static inline void dump() {}
+		static inline void reset() {}
+};
+
+#define PROFILE_STAGE(id, label) static_assert(true, "")
+#define LATENCY_PROBE(id) do {} while(0)
+
+#endif
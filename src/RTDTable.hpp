@@ -0,0 +1,117 @@
+#ifndef RTDTABLE_H
+#define RTDTABLE_H
+
+#include <array>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "MAX31865.hpp"
+
+namespace rtd_table_detail {
+
+constexpr double sqrt(double x) {
+  if (x <= 0)
+    return 0;
+
+  // Newton iteration, converges to the last bit well within the limit
+  double r = x > 1 ? x : 1;
+  for (int i = 0; i < 200; i++) {
+    double next = 0.5 * (r + x / r);
+    if (next == r)
+      break;
+    r = next;
+  }
+  return r;
+}
+
+// Same math as MAX31865::calculateTemperature(), in double precision
+constexpr double temperature(double code, double RTDnominal,
+                             double refResistor) {
+  double Rt = code / 32768 * refResistor;
+
+  double Z1 = -RTD_A;
+  double Z2 = RTD_A * RTD_A - (4 * RTD_B);
+  double Z3 = (4 * RTD_B) / RTDnominal;
+  double Z4 = 2 * RTD_B;
+
+  double temp = (sqrt(Z2 + (Z3 * Rt)) + Z1) / Z4;
+  if (temp >= 0)
+    return temp;
+
+  Rt /= RTDnominal;
+  Rt *= 100; // normalize to 100 ohm
+
+  double rpoly = Rt;
+
+  temp = -242.02;
+  temp += 2.2228 * rpoly;
+  rpoly *= Rt; // square
+  temp += 2.5859e-3 * rpoly;
+  rpoly *= Rt; // ^3
+  temp -= 4.8260e-6 * rpoly;
+  rpoly *= Rt; // ^4
+  temp -= 2.8183e-8 * rpoly;
+  rpoly *= Rt; // ^5
+  temp += 1.5243e-10 * rpoly;
+
+  return temp;
+}
+
+constexpr int32_t toMilli(double temp) {
+  return temp >= 0 ? (int32_t)(temp * 1000 + 0.5)
+                   : -(int32_t)(-temp * 1000 + 0.5);
+}
+
+} // namespace rtd_table_detail
+
+/*! Integer RTD code to temperature conversion, for CPUs without an FPU.
+    The curve of calculateTemperature() is sampled at compile time at
+    Segments + 1 evenly spaced codes, and a conversion is a table lookup plus
+    one linear interpolation. With the default 128 segments the table takes
+    516 bytes of flash and stays within 10 milli-degrees of the float
+    implementation.
+    @tparam RTDnominal The 'nominal' resistance of the RTD sensor in ohm,
+    usually 100 or 1000
+    @tparam refResistor The value of the matching reference resistor in ohm,
+    usually 430 or 4300
+    @tparam Segments Number of interpolation segments, a power of two */
+template <uint32_t RTDnominal, uint32_t refResistor, size_t Segments = 128>
+class RTDTable {
+  static_assert(Segments >= 2 && Segments <= 32768 &&
+                    (Segments & (Segments - 1)) == 0,
+                "Segments must be a power of two");
+
+  static constexpr uint32_t Step = 32768 / Segments;
+
+  static constexpr std::array<int32_t, Segments + 1> build() {
+    std::array<int32_t, Segments + 1> table{};
+    for (size_t i = 0; i <= Segments; i++) {
+      table[i] = rtd_table_detail::toMilli(
+          rtd_table_detail::temperature(i * Step, RTDnominal, refResistor));
+    }
+    return table;
+  }
+
+  static constexpr std::array<int32_t, Segments + 1> table = build();
+
+public:
+  /**************************************************************************/
+  /*!
+      @brief Convert a raw RTD code to temperature
+      @param RTDraw The 15-bit value as returned by MAX31865::readRTD()
+      @returns Temperature in milli-degrees C
+  */
+  /**************************************************************************/
+  static constexpr int32_t temperatureMilli(uint16_t RTDraw) {
+    if (RTDraw > 32767)
+      RTDraw = 32767;
+
+    const uint32_t i = RTDraw / Step;
+    const int32_t frac = RTDraw % Step;
+    const int32_t lower = table[i];
+
+    return lower + (table[i + 1] - lower) * frac / (int32_t)Step;
+  }
+};
+
+#endif
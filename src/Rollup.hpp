@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+    @brief  Summary of a set of samples.
+*/
+struct rollup_stats {
+	uint32_t count = 0;
+	int32_t min = 0;
+	int32_t max = 0;
+	int64_t sum = 0;
+
+	void add(int32_t value)
+	{
+		if(this->count == 0 || value < this->min) this->min = value;
+		if(this->count == 0 || value > this->max) this->max = value;
+		this->sum += value;
+		this->count++;
+	}
+
+	void merge(const rollup_stats &other)
+	{
+		if(other.count == 0) return;
+		if(this->count == 0 || other.min < this->min) this->min = other.min;
+		if(this->count == 0 || other.max > this->max) this->max = other.max;
+		this->sum += other.sum;
+		this->count += other.count;
+	}
+
+	int32_t mean() const
+	{
+		return this->count ? this->sum / this->count : 0;
+	}
+};
+
+
+/*!
+    @brief  Incremental min/max/mean roll-up over four resolutions: the last 60 seconds,
+            60 minutes, 24 hours and Days days.
+            Every sample updates one bucket per tier, so adding is O(1) and the footprint is fixed.
+            A window query merges whole buckets from the coarsest tier that has them and only
+            falls back to finer tiers for the ragged edges. Parts of a window older than the
+            retention of the tier they would need are left out, check count for coverage.
+    @tparam Days Number of day buckets to keep.
+*/
+template <uint16_t Days = 7>
+class Rollup {
+	static constexpr uint8_t Tiers = 4;
+	static constexpr uint32_t period[Tiers] = {1, 60, 3600, 86400};
+	static constexpr uint16_t slots[Tiers] = {60, 60, 24, Days};
+	static constexpr uint16_t offset[Tiers] = {0, 60, 120, 144};
+	static constexpr size_t Buckets = 144 + Days;
+
+	rollup_stats buckets[Buckets];
+	uint32_t index[Buckets] = {};  // period number each bucket currently holds
+	uint32_t latest = 0;           // newest sample time in seconds
+
+	// Merge the buckets of tier that fit inside [from, to), recursing into the finer tiers for the rest
+	void collect(uint8_t tier, uint64_t from, uint64_t to, rollup_stats &out) const
+	{
+		if(from >= to) return;
+
+		const uint32_t p = period[tier];
+		uint64_t first = (from + p - 1) / p;
+		uint64_t last = to / p;
+
+		if(first >= last)
+		{
+			if(tier > 0) this->collect(tier - 1, from, to, out);
+			return;
+		}
+
+		if(tier > 0)
+		{
+			this->collect(tier - 1, from, first * p, out);
+			this->collect(tier - 1, last * p, to, out);
+		}
+
+		// Only the newest slots[tier] periods are still held by the tier
+		const uint64_t newest = this->latest / p;
+		const uint64_t oldest = newest >= slots[tier] ? newest - slots[tier] + 1 : 0;
+
+		if(first < oldest) first = oldest;
+		if(last > newest + 1) last = newest + 1;
+
+		for(uint64_t i = first; i < last; i++)
+		{
+			const size_t b = offset[tier] + i % slots[tier];
+			if(this->index[b] == i) out.merge(this->buckets[b]);
+		}
+	}
+
+	public:
+		/*!
+		 * @brief Add a sample. Times must not go backwards.
+		 * @param time_s sample time in seconds
+		 * @param value sample value, e.g. milli-degrees C
+		 */
+		void add(uint32_t time_s, int32_t value)
+		{
+			for(uint8_t tier = 0; tier < Tiers; tier++)
+			{
+				const uint32_t i = time_s / period[tier];
+				const size_t b = offset[tier] + i % slots[tier];
+
+				if(this->index[b] != i || this->buckets[b].count == 0)
+				{
+					this->index[b] = i;
+					this->buckets[b] = rollup_stats();
+				}
+				this->buckets[b].add(value);
+			}
+
+			this->latest = time_s;
+		}
+
+		/*!
+		 * @brief Summarise the samples in [from_s, to_s).
+		 */
+		rollup_stats query(uint32_t from_s, uint32_t to_s) const
+		{
+			rollup_stats out;
+			this->collect(Tiers - 1, from_s, to_s, out);
+			return out;
+		}
+
+		/*!
+		 * @brief Summarise the last seconds, up to and including the newest sample.
+		 */
+		rollup_stats last(uint32_t seconds) const
+		{
+			const uint64_t to = (uint64_t)this->latest + 1;
+			rollup_stats out;
+			this->collect(Tiers - 1, to > seconds ? to - seconds : 0, to, out);
+			return out;
+		}
+};
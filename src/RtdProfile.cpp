@@ -0,0 +1,83 @@
+#include "RtdProfile.hpp"
+#include <cmath>
+
+/**************************************************************************/
+/*!
+    @brief Precompute the conversion constants for a sensor
+    @param RTDnominal The 'nominal' resistance of the RTD sensor, usually 100
+    or 1000
+    @param refResistor The value of the matching reference resistor, usually
+    430 or 4300
+    @param A Callendar-Van Dusen A coefficient
+    @param B Callendar-Van Dusen B coefficient
+    @param C Callendar-Van Dusen C coefficient, only used below 0 C
+*/
+/**************************************************************************/
+RtdProfile::RtdProfile(float RTDnominal, float refResistor, float A, float B,
+                       float C)
+    : nominal(RTDnominal), scale(refResistor / 32768), A(A), B(B), C(C) {
+  // Same solution as MAX31865::calculateTemperature(), with the code to ohm
+  // scale folded into Z3
+  Z1 = -A;
+  Z2 = A * A - (4 * B);
+  Z3 = (4 * B) / RTDnominal * scale;
+  invZ4 = 1 / (2 * B);
+
+  scale100 = scale * 100 / RTDnominal;
+
+  // The polynomial fit below 0 C is only valid for the standard 385 curve
+  standard = A == (float)RTD_A && B == (float)RTD_B && C == (float)RTD_C;
+}
+
+/**************************************************************************/
+/*!
+    @brief Calculate the RTD resistance
+    @param RTDraw The raw value as returned by MAX31865::readRTD()
+    @returns Resistance in ohm
+*/
+/**************************************************************************/
+float RtdProfile::resistance(uint16_t RTDraw) const { return RTDraw * scale; }
+
+/**************************************************************************/
+/*!
+    @brief Calculate the temperature in C
+    @param RTDraw The raw value as returned by MAX31865::readRTD()
+    @returns Temperature in C
+*/
+/**************************************************************************/
+float RtdProfile::temperature(uint16_t RTDraw) const {
+  float temp = (sqrtf(Z2 + Z3 * RTDraw) + Z1) * invZ4;
+
+  if (temp >= 0)
+    return temp;
+
+  if (standard) {
+    float Rt = RTDraw * scale100;
+    float rpoly = Rt;
+
+    temp = -242.02f;
+    temp += 2.2228f * rpoly;
+    rpoly *= Rt; // square
+    temp += 2.5859e-3f * rpoly;
+    rpoly *= Rt; // ^3
+    temp -= 4.8260e-6f * rpoly;
+    rpoly *= Rt; // ^4
+    temp -= 2.8183e-8f * rpoly;
+    rpoly *= Rt; // ^5
+    temp += 1.5243e-10f * rpoly;
+
+    return temp;
+  }
+
+  // Custom coefficients: refine the quadratic estimate with Newton steps on
+  // R(t) / R0 = 1 + A t + B t^2 + C (t - 100) t^3
+  const float ratio = RTDraw * scale / nominal;
+  for (int i = 0; i < 3; i++) {
+    float t2 = temp * temp;
+    float f = 1 + A * temp + B * t2 + C * (temp - 100) * t2 * temp - ratio;
+    float df = A + 2 * B * temp + C * (4 * temp - 300) * t2;
+    temp -= f / df;
+  }
+
+  return temp;
+}
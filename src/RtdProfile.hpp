@@ -0,0 +1,33 @@
+#ifndef RTDPROFILE_H
+#define RTDPROFILE_H
+
+#include <stdint.h>
+
+#include "MAX31865.hpp"
+
+/*! Conversion constants for one RTD sensor, computed once so that each
+    sample only costs a square root and a few multiplies. Supports custom
+    Callendar-Van Dusen coefficients for non-385 curves or per-sensor
+    calibration */
+class RtdProfile {
+public:
+  RtdProfile(float RTDnominal, float refResistor, float A = RTD_A,
+             float B = RTD_B, float C = RTD_C);
+
+  float resistance(uint16_t RTDraw) const;
+  float temperature(uint16_t RTDraw) const;
+
+private:
+  float nominal;
+  float scale; // refResistor / 32768, ohm per RTD code
+  float A, B, C;
+
+  // Quadratic solution for t >= 0: t = (sqrt(Z2 + Z3 * RTDraw) + Z1) * invZ4
+  float Z1, Z2, Z3, invZ4;
+
+  // RTD code to ohm normalized to a 100 ohm sensor, for the 385 curve fit
+  float scale100;
+  bool standard;
+};
+
+#endif
@@ -1,93 +1,138 @@
 #include "SSD1306.hpp"
+#include "Profiler.hpp"
+
+PROFILE_STAGE(profile_display, "SSD1306::display");
+PROFILE_STAGE(profile_flush_async, "SSD1306::flushAsync");
+
+namespace {
+
+	template <typename T>
+	inline static T applyColor(T value, T mask, colors Color)
+	{
+		switch(Color)
+		{
+			case colors::WHITE:
+				return value | mask;
+			case colors::BLACK:
+				return value & ~mask;
+			case colors::INVERSE:
+				return value ^ mask;
+		}
+		return value;
+	}
+
+	inline static uint8_t widthOf(size Size)
+	{
+		return Size == size::W64xH32 ? 64 : 128;
+	}
+
+	inline static uint8_t heightOf(size Size)
+	{
+		return Size == size::W128xH64 ? 64 : 32;
+	}
+
+};
 
 /*!
     @brief  Constructor for I2C-interfaced OLED display.
     @param  DevAddr
             Device i2c address shifted one to the left.
-    @param  width
-            Display width.
-    @param  height
-            Display height.
+    @param  Size
+            Display size.
     @param  i2c
             Pointer to an existing i2c instance.
     @return SSD1306 object.
 */
-SSD1306::SSD1306(uint16_t const DevAddr, size Size, i2c_inst_t * i2c) : DevAddr(DevAddr), width(width), height(height), i2c(i2c), Size(Size)
-{
-	if(this->Size == size::W64xH32)
-	{
-		this->width = 64;
-		this->height = 32;
-	} else if (this->Size == size::W128xH64)
-	{
-		this->width = 128;
-		this->height = 64;
-	} else
-	{
-		this->width = 128;
-		this->height = 32;
-	}
+SSD1306::SSD1306(uint16_t const DevAddr, size Size, i2c_inst_t * i2c) : SSD1306(DevAddr, Size, i2c, nullptr) {}
 
-	this->bufferlen = this->width * (this->height / 8);
-	this->buffer = new unsigned char[this->bufferlen];
 
-	this->displayON(false);
+/*!
+    @brief  Constructor for I2C-interfaced OLED display drawing into caller owned storage.
+    @param  DevAddr
+            Device i2c address shifted one to the left.
+    @param  Size
+            Display size.
+    @param  i2c
+            Pointer to an existing i2c instance.
+    @param  storage
+            Framebuffer storage of width * height / 8 + 1 bytes, or nullptr to allocate it.
+    @return SSD1306 object.
+*/
+SSD1306::SSD1306(uint16_t const DevAddr, size Size, i2c_inst_t * i2c, unsigned char * storage)
+	: DevAddr(DevAddr), i2c(i2c), width(widthOf(Size)), height(heightOf(Size)), Size(Size)
+{
+	this->bufferlen = this->width * (this->height / 8);
+	// One spare byte in front of the buffer holds the data control byte, see sendData()
+	this->owns_buffer = storage == nullptr;
+	if(this->owns_buffer) storage = new unsigned char[this->bufferlen + 1];
+	this->buffer = storage + 1;
 
 	// this->sendCommand(SSD1306_SETLOWCOLUMN);
 	// this->sendCommand(SSD1306_SETHIGHCOLUMN);
-    
-	/* memory mapping */
-	this->sendCommand(SSD1306_MEMORYMODE); // set memory address mode 0 = horizontal, 1 = vertical, 2 = page
-	this->sendCommand(0x00); // horizontal addressing mode
 
-    /* resolution and layout */
-	this->sendCommand(SSD1306_SETSTARTLINE); // set display start line to 0
-	this->sendCommand(SSD1306_SEGREMAP | 0x01); // set segment re-map, column address 127 is mapped to SEG0
+	// The whole init sequence goes out as one command list
+	const uint8_t init[] = {
+		SSD1306_DISPLAYOFF,
+
+		/* memory mapping */
+		SSD1306_MEMORYMODE, // set memory address mode 0 = horizontal, 1 = vertical, 2 = page
+		0x00, // horizontal addressing mode
+
+		/* resolution and layout */
+		SSD1306_SETSTARTLINE, // set display start line to 0
+		SSD1306_SEGREMAP | 0x01, // set segment re-map, column address 127 is mapped to SEG0
+
+		SSD1306_SETMULTIPLEX, // set multiplex ratio
+		(uint8_t)(this->height - 1), // our display is only 32 pixels high
+
+		SSD1306_COMSCANINC | 0x08, // set COM (common) output scan direction. Scan from bottom up, COM[N-1] to COM0
+
+		SSD1306_SETDISPLAYOFFSET, // set display offset
+		0x00, // no offset
+
+		SSD1306_SETCOMPINS, // set COM (common) pins hardware configuration. Board specific magic number.
+		                    // 0x02 Works for 128x32, 0x12 Possibly works for 128x64. Other options 0x22, 0x32
+		0x02, // manufacturer magic number
 
-	this->sendCommand(SSD1306_SETMULTIPLEX); // set multiplex ratio
-	this->sendCommand(height - 1); // our display is only 32 pixels high
+		SSD1306_SETDISPLAYCLOCKDIV, // set display clock divide ratio
+		0x80, // div ratio of 1, standard freq
 
-	this->sendCommand(SSD1306_COMSCANINC | 0x08); // set COM (common) output scan direction. Scan from bottom up, COM[N-1] to COM0
-	
-	this->sendCommand(SSD1306_SETDISPLAYOFFSET); // set display offset
-	this->sendCommand(0x00); // no offset
+		SSD1306_SETPRECHARGE, // set pre-charge period
+		0xF1, // Vcc internally generated on our board
 
-	this->sendCommand(SSD1306_SETCOMPINS); // set COM (common) pins hardware configuration. Board specific magic number. 
-                                           // 0x02 Works for 128x32, 0x12 Possibly works for 128x64. Other options 0x22, 0x32
-	this->sendCommand(0x02); // manufacturer magic number
-	
-	this->sendCommand(SSD1306_SETDISPLAYCLOCKDIV); // set display clock divide ratio
-	this->sendCommand(0x80); // div ratio of 1, standard freq
+		SSD1306_SETVCOMDETECT, // set VCOMH deselect level
+		0x40,
 
-	this->sendCommand(SSD1306_SETPRECHARGE); // set pre-charge period
-	this->sendCommand(0xF1); // Vcc internally generated on our board
+		SSD1306_SETCONTRAST, // set contrast control
+		0xFF,
 
-	this->sendCommand(SSD1306_SETVCOMDETECT); // set VCOMH deselect level
-	this->sendCommand(0x40);
+		SSD1306_DISPLAYALLON_RESUME, // set entire display on to follow RAM content
 
-	this->setContrast(0xFF); // set contrast control
+		SSD1306_NORMALDISPLAY, // set normal (not inverted) display
 
-	this->sendCommand(SSD1306_DISPLAYALLON_RESUME); // set entire display on to follow RAM content
+		SSD1306_CHARGEPUMP, // set charge pump
+		0x14, // Vcc internally generated on our board
 
-	this->sendCommand(SSD1306_NORMALDISPLAY); // set normal (not inverted) display
+		SSD1306_SETSCROLL | 0x00, // deactivate horizontal scrolling if set. This is necessary as memory writes will corrupt if scrolling was enabled
 
-	this->sendCommand(SSD1306_CHARGEPUMP); // set charge pump
-	this->sendCommand(0x14); // Vcc internally generated on our board
-	
-	this->sendCommand(SSD1306_SETSCROLL | 0x00); // deactivate horizontal scrolling if set. This is necessary as memory writes will corrupt if scrolling was enabled
+		SSD1306_DISPLAYON
+	};
 
-	this->displayON(1);
+	this->sendCommands(init, sizeof(init));
 
 	    // Initialize render area for entire frame (SSD1306_WIDTH pixels by SSD1306_NUM_PAGES pages)
     this->frame_area = {
         start_col: 0,
-        end_col : this->width - 1,
+        end_col : (uint8_t)(this->width - 1),
         start_page : 0,
-        end_page : (this->height / 8) - 1
+        end_page : (uint8_t)(this->height / 8 - 1)
         };
 
     this->calculateRenderAreaBuffLen(&frame_area);
 
+	// GDDRAM content is unknown after power up, so the first display() sends everything
+	this->invalidate();
+
 	// this->rotateDisplay(1);
 	// this->sendCommand(0x3F);
 	// this->clear();
@@ -100,7 +145,11 @@ SSD1306::SSD1306(uint16_t const DevAddr, size Size, i2c_inst_t * i2c) : DevAddr(
 */
 SSD1306::~SSD1306() 
 {
-	delete this->buffer;
+	this->waitFlush();
+
+	if(this->dma_chan >= 0) dma_channel_unclaim(this->dma_chan);
+	delete[] this->dma_buffer;
+	if(this->owns_buffer) delete[] (this->buffer - 1);
 }
 
 
@@ -110,8 +159,34 @@ SSD1306::~SSD1306()
  */
 void SSD1306::sendCommand(uint8_t command)
 {	
-	uint8_t mess[2] = {0x00, command};
-	i2c_write_blocking(this->i2c, this->DevAddr, mess, 2, false);
+	this->sendCommands(&command, 1);
+}
+
+
+/*!
+ * @brief Send a list of commands to display.
+ * All bytes are packed behind a single command control byte, so the list costs one
+ * I2C transaction (one per SSD1306_DATA_CHUNK bytes) instead of one per byte.
+ * @param commands Pointer to command bytes, including their arguments.
+ * @param count Number of bytes.
+ */
+void SSD1306::sendCommands(const uint8_t* commands, size_t count)
+{
+	uint8_t mess[SSD1306_DATA_CHUNK + 1];
+	mess[0] = 0x00;
+
+	this->waitFlush();
+
+	while(count)
+	{
+		size_t len = count < SSD1306_DATA_CHUNK ? count : SSD1306_DATA_CHUNK;
+
+		memcpy(mess + 1, commands, len);
+		i2c_write_blocking(this->i2c, this->DevAddr, mess, len + 1, false);
+
+		commands += len;
+		count -= len;
+	}
 }
 
 
@@ -133,13 +208,17 @@ void SSD1306::rotateDisplay(uint8_t Rotate)
 {
 	if(Rotate > 1) Rotate = 1;
 
-	this->sendCommand(0xA0 | (0x01 & Rotate));  // Set Segment Re-Map Default
+	const uint8_t commands[] = {
+		(uint8_t)(0xA0 | (0x01 & Rotate)),  // Set Segment Re-Map Default
 							// 0xA0 (0x00) => column Address 0 mapped to 127
                 			// 0xA1 (0x01) => Column Address 127 mapped to 0
 
-	this->sendCommand(0xC0 | (0x08 & (Rotate<<3)));  // Set COM Output Scan Direction
+		(uint8_t)(0xC0 | (0x08 & (Rotate<<3)))  // Set COM Output Scan Direction
 							// 0xC0	(0x00) => normal mode (RESET) Scan from COM0 to COM[N-1];Where N is the Multiplex ratio.
 							// 0xC8	(0xC8) => remapped mode. Scan from COM[N-1] to COM0;;Where N is the Multiplex ratio.
+	};
+
+	this->sendCommands(commands, sizeof(commands));
 }
 
 
@@ -160,8 +239,79 @@ void SSD1306::displayON(uint8_t On)
  */
 void SSD1306::setContrast(uint8_t Contrast)
 {
-	this->sendCommand(SSD1306_SETCONTRAST);
-	this->sendCommand(Contrast);
+	const uint8_t commands[] = {SSD1306_SETCONTRAST, Contrast};
+	this->sendCommands(commands, sizeof(commands));
+}
+
+
+/*!
+ * @brief Let the controller scroll a band of pages horizontally, without sending any pixel data.
+ * The band wraps around, what leaves on one side comes back on the other. The current frame is
+ * flushed first. While the band scrolls, flushes skip its pages and keep them dirty.
+ * @param direction scroll::LEFT or scroll::RIGHT
+ * @param start_page first page of the band
+ * @param end_page last page of the band, inclusive
+ * @param interval frames between one column steps
+ */
+void SSD1306::startScroll(scroll direction, uint8_t start_page, uint8_t end_page, scroll_interval interval)
+{
+	if(start_page > end_page || end_page >= this->height / 8) return;
+
+	// The scroll setup must not change while scrolling, and it moves what GDDRAM holds now
+	this->stopScroll();
+	this->display();
+
+	const uint8_t commands[] = {
+		(uint8_t)(direction == scroll::LEFT ? SSD1306_SETLEFTHORIZSCROLL : SSD1306_SETHORIZSCROLL),
+		0x00, // dummy byte
+		start_page,
+		(uint8_t)interval,
+		end_page,
+		0x00, 0xFF, // dummy bytes
+		SSD1306_ACTIVATESCROLL
+	};
+	this->sendCommands(commands, sizeof(commands));
+
+	this->scrolling = true;
+	this->scroll_start = start_page;
+	this->scroll_end = end_page;
+}
+
+
+/*!
+ * @brief Stop the horizontal scroll.
+ * The controller has rotated the band by some number of columns, so its pages are marked dirty
+ * and the next flush puts back what the buffer holds.
+ */
+void SSD1306::stopScroll()
+{
+	if(!this->scrolling) return;
+
+	this->sendCommand(SSD1306_SETSCROLL);
+	this->scrolling = false;
+
+	for(uint8_t page = this->scroll_start; page <= this->scroll_end; page++)
+	{
+		this->markDirty(page, 0, this->width - 1);
+	}
+}
+
+
+/*!
+ * @brief Set the GDDRAM row shown on the top line of the panel, rows below follow and wrap.
+ * Moving it by one scrolls the whole picture vertically by one row at the cost of one command,
+ * the buffer keeps mirroring GDDRAM. Buffer row (y + line) % 64 appears at screen row y.
+ * The controller wraps over all 64 rows, so this needs a 64 row panel.
+ * @param line first row to show (0, 63)
+ * @return false if the panel has fewer than 64 rows or line is out of range
+ */
+bool SSD1306::setStartLine(uint8_t line)
+{
+	if(this->height < SSD1306_RAM_ROWS || line >= SSD1306_RAM_ROWS) return false;
+
+	this->sendCommand(SSD1306_SETSTARTLINE | line);
+	this->start_line = line;
+	return true;
 }
 
 
@@ -187,22 +337,70 @@ void SSD1306::drawPixel(int16_t x, int16_t y, colors Color)
 
 	const int BytesPerRow = this->width ; // x pixels, 1bpp, but each row is 8 pixel high, so (x / 8) * 8
 
-    int byte_idx = (y / 8) * BytesPerRow + x;
-    uint8_t byte = this->buffer[byte_idx];
+	// Only pixels that actually change have to go over the bus on the next display()
+	const uint8_t page = (uint16_t)y / 8;
+	this->writeMasked(page * BytesPerRow + x, page, x, 1 << ((uint16_t)y % 8), Color);
+}
+
 
-	switch(Color)
+/*!
+ * @brief Apply a color to the same bits of a run of columns in one page.
+ * Works on whole bytes, and on 32-bit words (mask repeated in every byte) where the run is aligned.
+ * The dirty range covers exactly the bytes that changed, as drawPixel() would mark them.
+ * @param page page (row of 8 pixels) to draw into
+ * @param start_col first column
+ * @param end_col last column, inclusive
+ * @param mask bits of each byte to change, bit 0 is the top pixel of the page
+ * @param color colors::BLACK, colors::WHITE or colors::INVERSE
+ */
+void SSD1306::fillSpan(uint8_t page, uint8_t start_col, uint8_t end_col, uint8_t mask, colors Color)
+{
+	unsigned char * row = this->buffer + page * this->width;
+	int col = start_col;
+	int first = -1;
+	int last = -1;
+
+	// Leading bytes up to a word boundary
+	for(; col <= end_col && ((uintptr_t)(row + col) & 3); col++)
 	{
-		case colors::WHITE:
-			byte |=  1 << (y % 8); 
-			break;
-		case colors::BLACK:
-			byte &= ~(1 << (y % 8));
-			break;
-		case colors::INVERSE: 
-			byte ^= (1 << (y % 8));
-			break;
+		uint8_t byte = applyColor<uint8_t>(row[col], mask, Color);
+		if(byte != row[col])
+		{
+			row[col] = byte;
+			if(first < 0) first = col;
+			last = col;
+		}
+	}
+
+	const uint32_t mask32 = mask * 0x01010101u;
+	for(; col + 3 <= end_col; col += 4)
+	{
+		uint32_t word;
+		memcpy(&word, row + col, 4);
+		uint32_t result = applyColor<uint32_t>(word, mask32, Color);
+		if(result != word)
+		{
+			memcpy(row + col, &result, 4);
+
+			// Only the bytes that changed are dirty, the lowest byte is the leftmost column (little endian)
+			const uint32_t changed = result ^ word;
+			if(first < 0) first = col + __builtin_ctz(changed) / 8;
+			last = col + (31 - __builtin_clz(changed)) / 8;
+		}
 	}
-	this->buffer[byte_idx] = byte;
+
+	for(; col <= end_col; col++)
+	{
+		uint8_t byte = applyColor<uint8_t>(row[col], mask, Color);
+		if(byte != row[col])
+		{
+			row[col] = byte;
+			if(first < 0) first = col;
+			last = col;
+		}
+	}
+
+	if(first >= 0) this->markDirty(page, first, last);
 }
 
 
@@ -212,67 +410,307 @@ void SSD1306::drawPixel(int16_t x, int16_t y, colors Color)
  */
 void SSD1306::clear(colors Color)
 {
+	uint8_t fill;
+
 	switch (Color)
 	{
 		case colors::WHITE:
-			memset(buffer, 0xFF, this->bufferlen);
+			fill = 0xFF;
 			break;
 		case colors::BLACK:
-			memset(buffer, 0x00, this->bufferlen);
+			fill = 0x00;
 			break;
+		default:
+			return;
+	}
+
+	// Mark only the columns that differ from the fill value, so clearing an already blank area costs no bus time
+	for(uint8_t page = 0; page < this->height / 8; page++)
+	{
+		unsigned char * row = this->buffer + page * this->width;
+		int first = 0;
+		int last = this->width - 1;
+
+		while(first <= last && row[first] == fill) first++;
+		while(last >= first && row[last] == fill) last--;
+
+		if(first <= last) this->markDirty(page, first, last);
+	}
+
+	memset(buffer, fill, this->bufferlen);
+}
+
+
+/*!
+ * @brief Mark the whole buffer as changed, the next display() sends a full frame.
+ */
+void SSD1306::invalidate()
+{
+	for(uint8_t page = 0; page < SSD1306_MAX_PAGES; page++)
+	{
+		this->dirty_start[page] = SSD1306_PAGE_CLEAN;
+		this->dirty_end[page] = SSD1306_PAGE_CLEAN;
+	}
+
+	for(uint8_t page = 0; page < this->height / 8; page++)
+	{
+		this->markDirty(page, 0, this->width - 1);
 	}
 }
 
 
 /*!
  * @brief Send buffer to OLED GCRAM.
- * @param data (Optional) Pointer to data array.
+ * Without data only the columns changed since the last call are sent, one window per page.
+ * Consecutive fully changed pages are merged into a single window.
+ * @param data (Optional) Pointer to data array, always sent as a full frame.
  */
 void SSD1306::display(unsigned char *data)
 {
-	if(data == nullptr) data = this->buffer;
-	this->sendCommand(0x21); // SSD1306_SET_COL_ADDR
-	this->sendCommand(frame_area.start_col);
-	this->sendCommand(frame_area.end_col);
-	this->sendCommand(0x22);// SSD1306_SET_PAGE_ADDR
-	this->sendCommand(frame_area.start_page);
-	this->sendCommand(frame_area.end_page);
-	this->sendData(data, this->bufferlen);
+	LATENCY_PROBE(profile_display);
+
+	if(data != nullptr)
+	{
+		this->stopScroll();
+		this->setRenderArea(&frame_area);
+		this->sendExternalData(data, this->bufferlen);
+
+		// GDDRAM no longer matches our buffer
+		this->invalidate();
+		return;
+	}
+
+	const uint8_t pages = this->height / 8;
+	uint8_t page = 0;
+
+	while(page < pages)
+	{
+		if(!this->isPending(page))
+		{
+			page++;
+			continue;
+		}
+
+		struct render_area area = {
+			start_col : this->dirty_start[page],
+			end_col : this->dirty_end[page],
+			start_page : page,
+			end_page : page
+			};
+
+		// Full width pages are contiguous in the buffer, send a run of them in one go
+		if(area.start_col == 0 && area.end_col == this->width - 1)
+		{
+			while(area.end_page + 1 < pages
+				&& this->isPending(area.end_page + 1)
+				&& this->dirty_start[area.end_page + 1] == 0
+				&& this->dirty_end[area.end_page + 1] == this->width - 1)
+			{
+				area.end_page++;
+			}
+		}
+
+		this->calculateRenderAreaBuffLen(&area);
+		this->setRenderArea(&area);
+		this->sendData(this->buffer + area.start_page * this->width + area.start_col, area.buflen);
+
+		for(; page <= area.end_page; page++)
+		{
+			this->dirty_start[page] = SSD1306_PAGE_CLEAN;
+			this->dirty_end[page] = SSD1306_PAGE_CLEAN;
+		}
+	}
 }
 
 
+/*!
+ * @brief Set the GDDRAM window the following data is written to.
+ * @param area Columns and pages of the window.
+ */
+void SSD1306::setRenderArea(struct render_area *area)
+{
+	const uint8_t commands[] = {
+		SSD1306_COLUMNADDR, area->start_col, area->end_col,
+		SSD1306_PAGEADDR, area->start_page, area->end_page
+	};
+
+	this->sendCommands(commands, sizeof(commands));
+}
+
+
+/*!
+ * @brief Send data to OLED GCRAM straight from the buffer, without copying.
+ * The byte in front of the data is temporarily replaced by the data control byte,
+ * so buffer must point into our buffer (which reserves a leading byte for this).
+ */
 void SSD1306::sendData(uint8_t* buffer, size_t buff_size)
 {
-	unsigned char mess[buff_size+1];
+	this->waitFlush();
+
+	uint8_t saved = buffer[-1];
+	buffer[-1] = 0x40;
+
+	i2c_write_blocking(this->i2c, this->DevAddr, buffer - 1, buff_size + 1, false);
+
+	buffer[-1] = saved;
+}
 
+
+/*!
+ * @brief Send data that does not live in our buffer to OLED GCRAM.
+ * The data is sent in small chunks, each in its own transaction. GCRAM keeps its
+ * address pointer between transactions, so the chunks continue where the last one ended.
+ */
+void SSD1306::sendExternalData(const uint8_t* data, size_t buff_size)
+{
+	uint8_t mess[SSD1306_DATA_CHUNK + 1];
 	mess[0] = 0x40;
-	memcpy(mess+1, buffer, buff_size);
 
-	i2c_write_blocking(this->i2c, this->DevAddr, mess, buff_size+1, false);
+	while(buff_size)
+	{
+		size_t len = buff_size < SSD1306_DATA_CHUNK ? buff_size : SSD1306_DATA_CHUNK;
+
+		memcpy(mess + 1, data, len);
+		this->waitFlush();
+		i2c_write_blocking(this->i2c, this->DevAddr, mess, len + 1, false);
+
+		data += len;
+		buff_size -= len;
+	}
 }
 
 
-void SSD1306::calculateRenderAreaBuffLen(struct render_area *area) {
-    // calculate how long the flattened buffer will be for a render area
-    area->buflen = (area->end_col - area->start_col + 1) * (area->end_page - area->start_page + 1);
+/*!
+ * @brief Start sending the changed part of the buffer to OLED GCRAM without blocking.
+ * The same windows display() would send are packed, together with their COLUMNADDR/PAGEADDR
+ * commands, into a front buffer of I2C data/command words separated by repeated STARTs, and
+ * handed to a DMA channel feeding the I2C TX FIFO. Drawing into the buffer can continue while
+ * the frame is on the wire. Waits for a previous flush to finish first.
+ */
+void SSD1306::flushAsync()
+{
+	LATENCY_PROBE(profile_flush_async);
+
+	this->waitFlush();
+
+	const uint8_t pages = this->height / 8;
+
+	if(this->dma_chan < 0)
+	{
+		this->dma_chan = dma_claim_unused_channel(true);
+		// Every page may need its own window: 7 command words and 1 data control word
+		this->dma_buffer = new uint16_t[this->bufferlen + pages * 8];
+	}
+
+	size_t len = 0;
+	uint8_t page = 0;
+
+	while(page < pages)
+	{
+		if(!this->isPending(page))
+		{
+			page++;
+			continue;
+		}
+
+		struct render_area area = {
+			start_col : this->dirty_start[page],
+			end_col : this->dirty_end[page],
+			start_page : page,
+			end_page : page
+			};
+
+		if(area.start_col == 0 && area.end_col == this->width - 1)
+		{
+			while(area.end_page + 1 < pages
+				&& this->isPending(area.end_page + 1)
+				&& this->dirty_start[area.end_page + 1] == 0
+				&& this->dirty_end[area.end_page + 1] == this->width - 1)
+			{
+				area.end_page++;
+			}
+		}
+
+		// Commands and data of every window are separate I2C transactions, chained by repeated STARTs
+		const uint16_t restart = len ? I2C_IC_DATA_CMD_RESTART_BITS : 0;
+		this->dma_buffer[len++] = restart | 0x00;
+		this->dma_buffer[len++] = SSD1306_COLUMNADDR;
+		this->dma_buffer[len++] = area.start_col;
+		this->dma_buffer[len++] = area.end_col;
+		this->dma_buffer[len++] = SSD1306_PAGEADDR;
+		this->dma_buffer[len++] = area.start_page;
+		this->dma_buffer[len++] = area.end_page;
+		this->dma_buffer[len++] = I2C_IC_DATA_CMD_RESTART_BITS | 0x40;
+
+		for(; page <= area.end_page; page++)
+		{
+			const unsigned char * row = this->buffer + page * this->width;
+			for(uint8_t col = area.start_col; col <= area.end_col; col++)
+			{
+				this->dma_buffer[len++] = row[col];
+			}
+
+			this->dirty_start[page] = SSD1306_PAGE_CLEAN;
+			this->dirty_end[page] = SSD1306_PAGE_CLEAN;
+		}
+	}
+
+	if(len == 0) return;
+
+	this->dma_buffer[len - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+	i2c_hw_t * hw = i2c_get_hw(this->i2c);
+	hw->enable = 0;
+	hw->tar = this->DevAddr;
+	hw->enable = 1;
+	(void) hw->clr_stop_det;
+
+	dma_channel_config c = dma_channel_get_default_config(this->dma_chan);
+	channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+	channel_config_set_read_increment(&c, true);
+	channel_config_set_write_increment(&c, false);
+	channel_config_set_dreq(&c, i2c_get_dreq(this->i2c, true));
+
+	this->flushing = true;
+	dma_channel_configure(this->dma_chan, &c, &hw->data_cmd, this->dma_buffer, len, true);
 }
 
+
 /*!
- * @brief Return display height.
- * @return display height
+ * @brief Check whether an asynchronous flush is still on the wire.
+ * If the transfer was aborted, e.g. not acknowledged, the whole buffer is marked dirty for the next flush.
+ * @return true until the DMA transfer is done and the I2C STOP went out
  */
-uint8_t SSD1306::getHeight()
+bool SSD1306::isFlushing()
 {
-	if(this->Size == size::W128xH64) return 64;
-	else return 32;
+	if(!this->flushing) return false;
+
+	i2c_hw_t * hw = i2c_get_hw(this->i2c);
+
+	if(dma_channel_is_busy(this->dma_chan)) return true;
+	if(!(hw->raw_intr_stat & (I2C_IC_RAW_INTR_STAT_STOP_DET_BITS | I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS))) return true;
+
+	// Nobody knows how much of the frame the controller took before the abort, so send all of it again
+	if(hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) this->invalidate();
+
+	(void) hw->clr_stop_det;
+	(void) hw->clr_tx_abrt;
+	this->flushing = false;
+
+	return false;
 }
 
+
 /*!
- * @brief Return display width.
- * @return display width
+ * @brief Block until a pending asynchronous flush has finished.
  */
-uint8_t SSD1306::getWidth()
+void SSD1306::waitFlush()
 {
-	if(this->Size == size::W64xH32) return 64;
-	else return 128;
-}
\ No newline at end of file
+	while(this->isFlushing()) tight_loop_contents();
+}
+
+
+void SSD1306::calculateRenderAreaBuffLen(struct render_area *area) {
+    // calculate how long the flattened buffer will be for a render area
+    area->buflen = (area->end_col - area->start_col + 1) * (area->end_page - area->start_page + 1);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+/*!
+    @brief  Lock-free single-producer/single-consumer ring buffer.
+            One context (a core or an interrupt) may push while another pops, without locks
+            or disabling interrupts. The head and tail counters run freely and are only written
+            by their owner, so every slot of the buffer is usable.
+    @tparam T Item type, copied in and out.
+    @tparam Capacity Number of slots, a power of two.
+*/
+template <typename T, size_t Capacity>
+class SPSCQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+	T items[Capacity];
+
+	std::atomic<uint32_t> head{0}; // next slot to write, owned by the producer
+	std::atomic<uint32_t> tail{0}; // next slot to read, owned by the consumer
+	std::atomic<uint32_t> drops{0}; // items push() turned away, owned by the producer
+
+	public:
+		/*!
+		 * @brief Append an item. Producer side only.
+		 * @return false if the queue is full, the item is dropped
+		 */
+		bool push(const T &item)
+		{
+			const uint32_t h = this->head.load(std::memory_order_relaxed);
+
+			if(h - this->tail.load(std::memory_order_acquire) == Capacity)
+			{
+				this->drops.store(this->drops.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+				return false;
+			}
+
+			this->items[h % Capacity] = item;
+			this->head.store(h + 1, std::memory_order_release);
+			return true;
+		}
+
+		/*!
+		 * @brief Take the oldest item. Consumer side only.
+		 * @return false if the queue is empty
+		 */
+		bool pop(T &item)
+		{
+			const uint32_t t = this->tail.load(std::memory_order_relaxed);
+
+			if(this->head.load(std::memory_order_acquire) == t) return false;
+
+			item = this->items[t % Capacity];
+			this->tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		/*!
+		 * @brief Take up to max of the oldest items at once. Consumer side only.
+		 * @return number of items copied to out
+		 */
+		size_t pop(T out[], size_t max)
+		{
+			const uint32_t t = this->tail.load(std::memory_order_relaxed);
+			const uint32_t available = this->head.load(std::memory_order_acquire) - t;
+			const size_t n = available < max ? available : max;
+
+			for(size_t i = 0; i < n; i++)
+			{
+				out[i] = this->items[(t + i) % Capacity];
+			}
+
+			this->tail.store(t + n, std::memory_order_release);
+			return n;
+		}
+
+		/*!
+		 * @brief Number of queued items, a snapshot the other side may already have changed.
+		 */
+		size_t size() const
+		{
+			return this->head.load(std::memory_order_acquire) - this->tail.load(std::memory_order_acquire);
+		}
+
+		bool empty() const { return this->size() == 0; }
+
+		/*!
+		 * @brief Number of items dropped because the queue was full, readable from either side.
+		 */
+		uint32_t dropped() const { return this->drops.load(std::memory_order_relaxed); }
+
+		static constexpr size_t capacity() { return Capacity; }
+};
@@ -1,15 +1,19 @@
 #pragma once
 
 #include "hardware/i2c.h"
+#include "hardware/dma.h"
 #include "string.h"
 #include "stdint.h"
+#include <array>
 
 
 #define SSD1306_MEMORYMODE 0x20
 #define SSD1306_COLUMNADDR 0x21
 #define SSD1306_PAGEADDR   0x22
 #define SSD1306_SETHORIZSCROLL 0x26
+#define SSD1306_SETLEFTHORIZSCROLL 0x27
 #define SSD1306_SETSCROLL 0x2E
+#define SSD1306_ACTIVATESCROLL 0x2F
 
 #define SSD1306_SETSTARTLINE 0x40
 
@@ -39,6 +43,11 @@
 #define SSD1306_EXTERNALVCC 0x1
 #define SSD1306_SWITCHCAPVCC 0x2
 
+#define SSD1306_MAX_PAGES 8
+#define SSD1306_PAGE_CLEAN 0xFF
+#define SSD1306_DATA_CHUNK 32
+#define SSD1306_RAM_ROWS 64
+
 
 enum class colors {
 	BLACK,
@@ -46,6 +55,23 @@ enum class colors {
 	INVERSE
 };
 
+enum class scroll {
+	LEFT,
+	RIGHT
+};
+
+// Frames between scroll steps, the values are the controller's interval codes
+enum class scroll_interval {
+	FRAMES_2 = 7,
+	FRAMES_3 = 4,
+	FRAMES_4 = 5,
+	FRAMES_5 = 0,
+	FRAMES_25 = 6,
+	FRAMES_64 = 1,
+	FRAMES_128 = 2,
+	FRAMES_256 = 3
+};
+
 enum class size {
 	W128xH64,
 	W128xH32,
@@ -71,11 +97,73 @@ class SSD1306 {
 		
 		unsigned char * buffer;
 		size_t bufferlen;
+		bool owns_buffer;
 
 		struct render_area frame_area;
 
+		// Per-page range of columns changed since the last display(), SSD1306_PAGE_CLEAN when untouched
+		uint8_t dirty_start[SSD1306_MAX_PAGES];
+		uint8_t dirty_end[SSD1306_MAX_PAGES];
+
+		// Front buffer for asynchronous flushes, one IC_DATA_CMD word per byte on the wire
+		uint16_t * dma_buffer = nullptr;
+		int dma_chan = -1;
+		bool flushing = false;
+
+		// Pages moved by the controller's horizontal scroll, GDDRAM there must not be written
+		bool scrolling = false;
+		uint8_t scroll_start = 0;
+		uint8_t scroll_end = 0;
+		uint8_t start_line = 0;
+
 		void sendData(uint8_t* buffer, size_t buff_size);
+		void sendExternalData(const uint8_t* data, size_t buff_size);
 		void sendCommand(uint8_t command);
+		void sendCommands(const uint8_t* commands, size_t count);
+		void setRenderArea(struct render_area *area);
+
+		inline void markDirty(uint8_t page, uint8_t start_col, uint8_t end_col)
+		{
+			if(this->dirty_start[page] == SSD1306_PAGE_CLEAN || start_col < this->dirty_start[page]) this->dirty_start[page] = start_col;
+			if(this->dirty_end[page] == SSD1306_PAGE_CLEAN || end_col > this->dirty_end[page]) this->dirty_end[page] = end_col;
+		}
+
+		// Apply Color to the bits in mask of one buffer byte, marking it dirty if it changed
+		inline void writeMasked(uint16_t byte_idx, uint8_t page, uint8_t col, uint8_t mask, colors Color)
+		{
+			uint8_t old = this->buffer[byte_idx];
+			uint8_t byte = old;
+
+			switch(Color)
+			{
+				case colors::WHITE:
+					byte |= mask;
+					break;
+				case colors::BLACK:
+					byte &= ~mask;
+					break;
+				case colors::INVERSE:
+					byte ^= mask;
+					break;
+			}
+
+			if(byte != old)
+			{
+				this->buffer[byte_idx] = byte;
+				this->markDirty(page, col, col);
+			}
+		}
+
+		void fillSpan(uint8_t page, uint8_t start_col, uint8_t end_col, uint8_t mask, colors Color);
+
+		// A page is sent on the next flush if it changed and the scroll does not hold it
+		inline bool isPending(uint8_t page)
+		{
+			if(this->dirty_start[page] == SSD1306_PAGE_CLEAN) return false;
+			return !this->scrolling || page < this->scroll_start || page > this->scroll_end;
+		}
+
+		SSD1306(uint16_t const DevAddr, size Size, i2c_inst_t * i2c, unsigned char * storage);
 
 	public:
 		SSD1306(uint16_t const DevAddr, size Size, i2c_inst_t * i2c);
@@ -86,12 +174,91 @@ class SSD1306 {
 		void rotateDisplay(uint8_t Rotate);
 		void setContrast(uint8_t Contrast);
 
+		void startScroll(scroll direction, uint8_t start_page, uint8_t end_page, scroll_interval interval = scroll_interval::FRAMES_5);
+		void stopScroll();
+		bool isScrolling() { return this->scrolling; }
+		bool setStartLine(uint8_t line);
+		uint8_t getStartLine() { return this->start_line; }
+
 		void drawPixel(int16_t x, int16_t y, colors Color = colors::WHITE);
 		void clear(colors Color = colors::BLACK);
 		void display(unsigned char *data = nullptr);
+		void invalidate();
+
+		void flushAsync();
+		bool isFlushing();
+		void waitFlush();
 
 		void calculateRenderAreaBuffLen(struct render_area *area);
 
-		uint8_t getHeight();
-		uint8_t getWidth();
+		uint8_t getHeight() { return this->height; }
+		uint8_t getWidth() { return this->width; }
+};
+
+
+constexpr size geometryToSize(uint8_t Width, uint8_t Height)
+{
+	return Width == 64 ? size::W64xH32 : (Height == 64 ? size::W128xH64 : size::W128xH32);
+}
+
+
+/*!
+    @brief  Framebuffer of an SSD1306Fixed. It is a base listed before SSD1306, so the array
+            exists by the time the SSD1306 constructor gets a pointer into it.
+*/
+template <size_t Len>
+struct ssd1306_storage {
+	// Leading spare byte for the data control byte, see SSD1306::sendData()
+	std::array<unsigned char, Len + 1> storage;
+};
+
+
+/*!
+    @brief  SSD1306 with display geometry fixed at compile time.
+            The framebuffer is part of the object instead of a heap allocation. drawPixel()
+            and getWidth()/getHeight() work on constants, and BasicGFX clips and indexes with
+            getWidth()/getHeight(), so its glyph and clipping math reduces to shifts too.
+            Span fills, flushing and scrolling are the runtime class's.
+            Draw on it through BasicGFX<SSD1306Fixed<Width, Height>>. The runtime class is a
+            protected base, so it cannot be used as an SSD1306 whose drawPixel() would bypass
+            the fixed one.
+    @tparam Width Display width, 64 or 128.
+    @tparam Height Display height, 32 or 64.
+*/
+template <uint8_t Width, uint8_t Height>
+class SSD1306Fixed : private ssd1306_storage<Width * (Height / 8)>, protected SSD1306 {
+	static_assert((Width == 128 && (Height == 64 || Height == 32)) || (Width == 64 && Height == 32),
+		"Supported geometries are 128x64, 128x32 and 64x32");
+
+	public:
+		SSD1306Fixed(uint16_t const DevAddr, i2c_inst_t * i2c)
+			: SSD1306(DevAddr, geometryToSize(Width, Height), i2c, this->storage.data()) {}
+
+		void drawPixel(int16_t x, int16_t y, colors Color = colors::WHITE)
+		{
+			assert(x >= 0 && x < Width && y >= 0 && y < Height);
+
+			const uint8_t page = (uint16_t)y / 8;
+			this->writeMasked(page * Width + x, page, x, 1 << ((uint16_t)y % 8), Color);
+		}
+
+		static constexpr uint8_t getHeight() { return Height; }
+		static constexpr uint8_t getWidth() { return Width; }
+
+		using SSD1306::displayON;
+		using SSD1306::invertColors;
+		using SSD1306::rotateDisplay;
+		using SSD1306::setContrast;
+		using SSD1306::startScroll;
+		using SSD1306::stopScroll;
+		using SSD1306::isScrolling;
+		using SSD1306::setStartLine;
+		using SSD1306::getStartLine;
+		using SSD1306::clear;
+		using SSD1306::display;
+		using SSD1306::invalidate;
+		using SSD1306::flushAsync;
+		using SSD1306::isFlushing;
+		using SSD1306::waitFlush;
+		using SSD1306::calculateRenderAreaBuffLen;
 };
\ No newline at end of file
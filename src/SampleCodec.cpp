@@ -0,0 +1,212 @@
+#include "SampleCodec.hpp"
+
+namespace {
+
+	inline static void put16(uint8_t * p, uint16_t v)
+	{
+		p[0] = v;
+		p[1] = v >> 8;
+	}
+
+	inline static uint16_t get16(const uint8_t * p)
+	{
+		return p[0] | (p[1] << 8);
+	}
+
+	inline static void put64(uint8_t * p, uint64_t v)
+	{
+		for(int i = 0; i < 8; i++) p[i] = v >> (8 * i);
+	}
+
+	inline static uint64_t get64(const uint8_t * p)
+	{
+		uint64_t v = 0;
+		for(int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+		return v;
+	}
+
+	inline static uint16_t zigzag(int16_t v)
+	{
+		return ((uint16_t)v << 1) ^ (uint16_t)(v >> 15);
+	}
+
+	inline static int16_t unzigzag(uint16_t v)
+	{
+		return (int16_t)((v >> 1) ^ -(v & 1));
+	}
+
+};
+
+
+/*!
+ * @brief Create an encoder writing into out. Call begin() before adding samples.
+ * @param out block buffer
+ * @param capacity size of out, at least SAMPLE_CODEC_HEADER_SIZE + 2
+ */
+SampleEncoder::SampleEncoder(uint8_t * out, size_t capacity) : out(out), capacity(capacity)
+{
+}
+
+
+/*!
+ * @brief Start a new block, discarding anything not finished.
+ * @param start_us timestamp of the first sample
+ * @param interval_ms time between samples
+ */
+void SampleEncoder::begin(uint64_t start_us, uint16_t interval_ms)
+{
+	this->out[0] = SAMPLE_CODEC_VERSION;
+	put64(this->out + 3, start_us);
+	put16(this->out + 11, interval_ms);
+
+	this->len = SAMPLE_CODEC_HEADER_SIZE;
+	this->samples = 0;
+}
+
+
+/*!
+ * @brief Add the next sample.
+ * @param code 15-bit RTD code as returned by MAX31865::readRTD()
+ * @param fault the conversion was flagged as faulty
+ * @return false if the block is full, finish it and begin a new one
+ */
+bool SampleEncoder::add(uint16_t code, bool fault)
+{
+	code &= 0x7FFF;
+
+	if(this->samples == 0)
+	{
+		put16(this->out + 13, code | (fault ? 0x8000 : 0));
+	}
+	else
+	{
+		if(this->len + SAMPLE_CODEC_MAX_SAMPLE > this->capacity || this->samples == UINT16_MAX) return false;
+
+		if(fault)
+		{
+			this->out[this->len++] = 0x80;
+			this->out[this->len++] = 0x00;
+		}
+
+		uint16_t v = zigzag(code - this->previous);
+		while(v >= 0x80)
+		{
+			this->out[this->len++] = v | 0x80;
+			v >>= 7;
+		}
+		this->out[this->len++] = v;
+	}
+
+	this->previous = code;
+	this->samples++;
+	return true;
+}
+
+
+/*!
+ * @brief Complete the block header.
+ * @return block length in bytes, 0 if no sample was added
+ */
+size_t SampleEncoder::finish()
+{
+	if(this->samples == 0) return 0;
+
+	put16(this->out + 1, this->samples);
+	return this->len;
+}
+
+
+/*!
+ * @brief Number of samples in the current block.
+ */
+uint16_t SampleEncoder::count()
+{
+	return this->samples;
+}
+
+
+/*!
+ * @brief Create a decoder over one block.
+ * @param block block as returned by SampleEncoder
+ * @param len block length
+ */
+SampleDecoder::SampleDecoder(const uint8_t * block, size_t len) : block(block), len(len)
+{
+}
+
+
+/*!
+ * @brief Check the block header.
+ */
+bool SampleDecoder::valid()
+{
+	return this->len >= SAMPLE_CODEC_HEADER_SIZE && this->block[0] == SAMPLE_CODEC_VERSION && this->count() > 0;
+}
+
+
+/*!
+ * @brief Decode the next sample.
+ * @return false after the last sample, or if the block is truncated or corrupt
+ */
+bool SampleDecoder::next(uint64_t &timestamp_us, uint16_t &code, bool &fault)
+{
+	if(!this->valid() || this->index >= this->count()) return false;
+
+	if(this->index == 0)
+	{
+		const uint16_t first = get16(this->block + 13);
+		code = first & 0x7FFF;
+		fault = first & 0x8000;
+	}
+	else
+	{
+		// 0x80 0x00 is the fault escape, the delta follows it
+		fault = this->pos + 1 < this->len && this->block[this->pos] == 0x80 && this->block[this->pos + 1] == 0x00;
+		if(fault) this->pos += 2;
+
+		uint16_t v = 0;
+		for(uint8_t shift = 0; ; shift += 7)
+		{
+			if(this->pos >= this->len || shift > 14) return false;
+
+			const uint8_t byte = this->block[this->pos++];
+			v |= (uint16_t)(byte & 0x7F) << shift;
+			if(!(byte & 0x80)) break;
+		}
+
+		code = (this->previous + unzigzag(v)) & 0x7FFF;
+	}
+
+	timestamp_us = this->start() + (uint64_t)this->index * this->interval() * 1000;
+
+	this->previous = code;
+	this->index++;
+	return true;
+}
+
+
+/*!
+ * @brief Number of samples in the block.
+ */
+uint16_t SampleDecoder::count()
+{
+	return get16(this->block + 1);
+}
+
+
+/*!
+ * @brief Timestamp of the first sample in us.
+ */
+uint64_t SampleDecoder::start()
+{
+	return get64(this->block + 3);
+}
+
+
+/*!
+ * @brief Time between samples in ms.
+ */
+uint16_t SampleDecoder::interval()
+{
+	return get16(this->block + 11);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SAMPLE_CODEC_VERSION 0xB2
+#define SAMPLE_CODEC_HEADER_SIZE 15
+#define SAMPLE_CODEC_MAX_SAMPLE 5   // fault escape plus a three byte delta
+
+/*!
+    @brief  Packs a stream of RTD samples taken at a fixed interval into a self-describing block.
+
+            Block layout: version (1), sample count (2), timestamp of the first sample in us since
+            boot (8, time_us_64(), so blocks keep their order and never wrap), interval in ms (2),
+            first code (2, bit 15 is the fault flag), then one delta per further sample. Deltas to the previous code are zig-zag mapped and written as
+            little-endian base-128 varints, so a slowly drifting reading costs one byte per sample.
+            A faulted sample is preceded by 0x80 0x00, an overlong zero the encoder never produces
+            otherwise. Timestamps are implicit: sample i was taken at start + i * interval.
+*/
+class SampleEncoder {
+	uint8_t * out;
+	size_t capacity;
+	size_t len = 0;
+	uint16_t samples = 0;
+	uint16_t previous = 0;
+
+	public:
+		SampleEncoder(uint8_t * out, size_t capacity);
+
+		void begin(uint64_t start_us, uint16_t interval_ms);
+		bool add(uint16_t code, bool fault);
+		size_t finish();
+
+		uint16_t count();
+};
+
+
+/*!
+    @brief  Reads back a block written by SampleEncoder, independently of any other block.
+*/
+class SampleDecoder {
+	const uint8_t * block;
+	size_t len;
+	size_t pos = SAMPLE_CODEC_HEADER_SIZE;
+	uint16_t index = 0;
+	uint16_t previous = 0;
+
+	public:
+		SampleDecoder(const uint8_t * block, size_t len);
+
+		bool valid();
+		bool next(uint64_t &timestamp_us, uint16_t &code, bool &fault);
+
+		uint16_t count();
+		uint64_t start();
+		uint16_t interval();
+};
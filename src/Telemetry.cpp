@@ -0,0 +1,70 @@
+#include "Telemetry.hpp"
+#include "Crc.hpp"
+#include "pico/time.h"
+
+namespace {
+
+	inline static void put16(uint8_t * p, uint16_t v)
+	{
+		p[0] = v;
+		p[1] = v >> 8;
+	}
+
+};
+
+
+/*!
+    @brief  Create a writer sending to a port.
+    @param  port
+            Destination of the packets, must outlive the writer.
+    @return TelemetryWriter object.
+*/
+TelemetryWriter::TelemetryWriter(TelemetryPort * port) : port(port)
+{
+}
+
+
+/*!
+ * @brief Queue a record, sending the frame once it is full.
+ */
+void TelemetryWriter::add(const telemetry_record &record)
+{
+	if(this->records == 0) this->oldest_us = time_us_64();
+
+	telemetryPutRecord(this->frame + 2 + this->records * TELEMETRY_RECORD_SIZE, record);
+
+	if(++this->records == TELEMETRY_RECORDS_PER_FRAME) this->flush();
+}
+
+
+/*!
+ * @brief Send a partly filled frame once its oldest record waited TELEMETRY_FLUSH_US. Call it from the main loop.
+ */
+void TelemetryWriter::poll()
+{
+	if(this->records && time_us_64() - this->oldest_us >= TELEMETRY_FLUSH_US) this->flush();
+}
+
+
+/*!
+ * @brief Send the queued records now.
+ */
+void TelemetryWriter::flush()
+{
+	if(this->records == 0) return;
+
+	const size_t len = 2 + this->records * TELEMETRY_RECORD_SIZE;
+	this->frame[0] = TELEMETRY_FRAME_TYPE;
+	this->frame[1] = this->sequence++;
+	put16(this->frame + len, crc16(this->frame, len));
+
+	uint8_t packet[TELEMETRY_PACKET_SIZE];
+	packet[0] = 0x00;
+	size_t n = 1 + cobsEncode(this->frame, len + 2, packet + 1);
+	packet[n++] = 0x00;
+
+	if(this->port->send(packet, n)) this->sent++;
+	else this->dropped++;
+
+	this->records = 0;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Cobs.hpp"
+
+#define TELEMETRY_FRAME_TYPE 0x55           // sample records, 0x54 frames carried 32-bit timestamps
+#define TELEMETRY_RECORD_SIZE 12
+#define TELEMETRY_RECORDS_PER_FRAME 4
+#define TELEMETRY_FRAME_SIZE (2 + TELEMETRY_RECORDS_PER_FRAME * TELEMETRY_RECORD_SIZE + 2)
+#define TELEMETRY_PACKET_SIZE 64            // full speed USB bulk packet
+#define TELEMETRY_FLUSH_US 20000            // longest a record waits for its frame to fill
+
+static_assert(COBS_MAX_ENCODED(TELEMETRY_FRAME_SIZE) + 2 <= TELEMETRY_PACKET_SIZE, "frame does not fit a packet");
+
+/*!
+    @brief  One sample on the wire.
+            Record layout, little-endian: timestamp in us (8, time_us_64(), never wraps), channel (1),
+            fault status register (1), RTD code (2, bit 15 is the fault bit of the RTD register).
+*/
+struct telemetry_record {
+	uint64_t timestamp_us;
+	uint8_t channel;
+	uint8_t fault_status;
+	uint16_t rtd;
+};
+
+/*!
+ * @brief Serialise a record into TELEMETRY_RECORD_SIZE bytes.
+ */
+inline void telemetryPutRecord(uint8_t * p, const telemetry_record &record)
+{
+	for(int i = 0; i < 8; i++) p[i] = record.timestamp_us >> (8 * i);
+	p[8] = record.channel;
+	p[9] = record.fault_status;
+	p[10] = record.rtd;
+	p[11] = record.rtd >> 8;
+}
+
+
+/*!
+ * @brief Read back a record written by telemetryPutRecord().
+ */
+inline telemetry_record telemetryGetRecord(const uint8_t * p)
+{
+	uint64_t timestamp_us = 0;
+	for(int i = 7; i >= 0; i--) timestamp_us = (timestamp_us << 8) | p[i];
+
+	return {timestamp_us, p[8], p[9], (uint16_t)(p[10] | (p[11] << 8))};
+}
+
+
+/*!
+    @brief  Where telemetry packets go. A packet is sent whole or not at all.
+*/
+class TelemetryPort {
+	public:
+		virtual ~TelemetryPort() {}
+
+		// Send one packet of at most TELEMETRY_PACKET_SIZE bytes, false if there is no room or no listener
+		virtual bool send(const uint8_t * packet, size_t len) = 0;
+};
+
+
+/*!
+    @brief  The RP2040's USB CDC interface, set up by pico_stdio_usb.
+*/
+class UsbTelemetryPort : public TelemetryPort {
+	public:
+		bool send(const uint8_t * packet, size_t len) override;
+};
+
+
+/*!
+    @brief  Batches records into COBS framed, CRC checked frames of one USB packet each.
+
+            Frame layout before stuffing: type (1), sequence (1), up to 4 records, CRC-16 (2) over
+            everything before it. After COBS encoding the frame is sent between two 0x00 delimiters,
+            so a reader can join the stream at any byte and resynchronise on the next zero, and
+            the first frame after opening the port is not lost to that. The sequence
+            counts frames, a gap tells the reader how many were lost.
+            A frame is sent when it is full, or by poll() once its oldest record is TELEMETRY_FLUSH_US
+            old. When the port has no room the frame is dropped rather than stalling the caller.
+*/
+class TelemetryWriter {
+	TelemetryPort * port;
+
+	uint8_t frame[TELEMETRY_FRAME_SIZE];
+	uint8_t records = 0;
+	uint8_t sequence = 0;
+	uint64_t oldest_us = 0;
+
+	uint32_t sent = 0;
+	uint32_t dropped = 0;
+
+	public:
+		TelemetryWriter(TelemetryPort * port);
+
+		void add(const telemetry_record &record);
+		void poll();
+		void flush();
+
+		uint32_t framesSent() { return this->sent; }
+		uint32_t framesDropped() { return this->dropped; }
+};
@@ -0,0 +1,26 @@
+#include "Telemetry.hpp"
+#include "hardware/sync.h"
+#include "tusb.h"
+
+
+/*!
+ * @brief Queue a packet on the CDC interface and flush it, so it goes out as one USB packet.
+ * The stdio_usb background task runs TinyUSB from an interrupt on this core, so the FIFO is
+ * only touched with interrupts off.
+ */
+bool UsbTelemetryPort::send(const uint8_t * packet, size_t len)
+{
+	if(!tud_cdc_connected()) return false;
+
+	const uint32_t ints = save_and_disable_interrupts();
+
+	bool ok = tud_cdc_write_available() >= len;
+	if(ok)
+	{
+		tud_cdc_write(packet, len);
+		tud_cdc_write_flush();
+	}
+
+	restore_interrupts(ints);
+	return ok;
+}
@@ -1,58 +1,58 @@
 #include <stdio.h>
 #include <stdint.h>
-#include <string>
 #include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/stdio_usb.h"
 #include "hardware/i2c.h"
 #include "hardware/spi.h"
 #include "pico/binary_info.h"
 // #include <logo.hpp>
 #include <GFX.hpp>
 #include <MAX31865.hpp>
+#include <SPSCQueue.hpp>
+#include <FlashDevice.hpp>
+#include <FlashLog.hpp>
+#include <Profiler.hpp>
+#include <Telemetry.hpp>
+#include <App.hpp>
+
+#define LOG_SECTORS 64            // 256 KB at the end of flash
+
+// Core 1 produces samples, core 0 consumes them
+static SPSCQueue<sample, 64> samples;
+static MAX31865 * sensor;
+
+/*!
+ * @brief Core 1: timed sensor acquisition, nothing else runs here so a slow display flush cannot delay a sample.
+ * The exception is the log: core 0 parks this core while it erases or programs flash, see FlashGuard
+ * in PicoFlash.cpp. A sample due in that window is taken late, by up to a sector erase, and the
+ * absolute deadlines put the following ones back on schedule.
+ */
+static void acquisition_core()
+{
+    // Let core 0 park this core while it erases or programs the log
+    multicore_lockout_victim_init();
+
+    absolute_time_t next = get_absolute_time();
+
+    while(true)
+    {
+        next = delayed_by_ms(next, SAMPLE_PERIOD_MS);
 
-#define READ_BIT 0x80
-
-static inline void cs_select() {
-    asm volatile("nop \n nop \n nop");
-    gpio_put(PICO_DEFAULT_SPI_CSN_PIN, 0);  // Active low
-    asm volatile("nop \n nop \n nop");
-}
-
-static inline void cs_deselect() {
-    asm volatile("nop \n nop \n nop");
-    gpio_put(PICO_DEFAULT_SPI_CSN_PIN, 1);
-    asm volatile("nop \n nop \n nop");
-}
-
-static void write_register(uint8_t reg, uint8_t data) {
-    uint8_t buf[2];
-    buf[0] = reg;  // remove read bit as this is a write
-    buf[1] = data;
-    cs_select();
-    spi_write_blocking(spi0, buf, 2);
-    cs_deselect();
-    sleep_ms(10);
-}
+        uint16_t rtd = sensor->readRTD();
+        const max31865_snapshot_t &snapshot = sensor->lastSnapshot();
+        // A full queue drops the sample, samples.dropped() counts it and App starts a new log block
+        samples.push({time_us_64(), rtd, snapshot.fault, snapshot.faultStatus});
 
-static void read_registers(uint8_t reg, uint8_t *buf, uint16_t len) {
-    // For this particular device, we send the device the register we want to read
-    // first, then subsequently read from the device. The register is auto incrementing
-    // so we don't need to keep sending the register we want, just the first.
-    cs_select();
-    spi_write_blocking(spi0, &reg, 1);
-    sleep_ms(10);
-    spi_read_blocking(spi0, 0, buf, len);
-    cs_deselect();
-    sleep_ms(10);
+        sleep_until(next);
+    }
 }
 
-
-
-
 int main() {
-    uint8_t temperature = 0;
-
     //setup
     stdio_init_all();
+    // USB carries the binary telemetry stream, text stays on the UART
+    stdio_set_driver_enabled(&stdio_usb, false);
 
     i2c_init(i2c0, 400 * 1000);
     gpio_set_function(PICO_DEFAULT_I2C_SDA_PIN, GPIO_FUNC_I2C);
@@ -60,13 +60,10 @@ int main() {
     gpio_pull_up(PICO_DEFAULT_I2C_SDA_PIN);
     gpio_pull_up(PICO_DEFAULT_I2C_SCL_PIN);
 
-    // Chip select is active-low, so we'll initialise it to a driven-high state
-    gpio_init(PICO_DEFAULT_SPI_CSN_PIN);
-    gpio_set_dir(PICO_DEFAULT_SPI_CSN_PIN, GPIO_OUT);
-    gpio_put(PICO_DEFAULT_SPI_CSN_PIN, 1);
-
     // This example will use SPI0 at 0.5MHz.
     spi_init(spi0, 500 * 1000);
+    // The MAX31865 samples on the second clock edge, SPI mode 1
+    spi_set_format(spi0, 8, SPI_CPOL_0, SPI_CPHA_1, SPI_MSB_FIRST);
 
     gpio_set_function(PICO_DEFAULT_SPI_RX_PIN, GPIO_FUNC_SPI);
     gpio_set_function(PICO_DEFAULT_SPI_SCK_PIN, GPIO_FUNC_SPI);
@@ -82,46 +79,50 @@ int main() {
 
     oled.clear(colors::BLACK);
 
-    MAX31865 temp(spi0);
+    PicoFlash flash(LOG_SECTORS);
+    FlashLog log(&flash);
+    log.begin();                            // Continue after the newest page found in flash
+    printf("Log resumes at page sequence %lu\n", (unsigned long)log.sequence());
 
-    uint8_t addr = 0x00;
-    uint8_t ret = 0;
-    addr &= 0x7F; // make sure top bit is not set
+    MAX31865 temp(spi0, PICO_DEFAULT_SPI_CSN_PIN);  // The driver owns the chip select pin
+    temp.begin(MAX31865_3WIRE);
 
-    read_registers(0x00, &ret, 1);
+    // From here on only core 1 touches the SPI bus
+    sensor = &temp;
+    multicore_launch_core1(acquisition_core);
 
-    uint8_t buffer[2] = {0x80, 0xD1};
-    cs_select();
-    spi_write_blocking(spi0, buffer, 2);
-    cs_deselect();
+    UsbTelemetryPort usb;
+    TelemetryWriter telemetry(&usb);
 
-    uint8_t ret2 =0;
-    read_registers(0x00, &ret2, 1);
+    // Static, the roll-up does not fit the core 0 stack
+    static App app(&oled, &log, &telemetry);
+    app.begin();
 
-    // temp.begin(MAX31865_3WIRE);
-    // temp.setWires(MAX31865_3WIRE);
-    // temp.readRTD();
-    // // Set 3 Wire
-    // write_register(0x80, 0xD1);
-   
-    // uint8_t buffer;
-
-    // read_registers(0x00, &buffer, 1);
+    uint32_t dropped = 0;
 
     while(true) 
     {
-        sleep_ms(1000);
-        // temperature = buffer;
-        // temperature = temp.temperature(100, 430);
-        temperature = rand() % 100 + 1;
-        oled.clear(colors::BLACK);
-        oled.drawString(0, 0, "Pico Temp Logger");
-        oled.drawHorizontalLine(0,9,oled.getWidth());
-        oled.drawString(0, 11, "Temperature :");
-        oled.drawString(oled.getWidth() - 20, 11, std::to_string(temperature));
-        oled.drawProgressBar(0, oled.getHeight()-5, oled.getWidth(), 5, temperature);
-
-        oled.display();                     //Send buffer to the screen
+        sample s;
+
+        // Send 'p' on the UART for the profiler table, 'r' to restart it
+#ifdef PICO_LOGGER_PROFILE
+        int key = getchar_timeout_us(0);
+        if(key == 'p') Profiler::dump();
+        if(key == 'r') Profiler::reset();
+#endif
+
+        // Drain everything core 1 produced into the log, the latest sample is shown
+        while(samples.pop(s)) app.add(s);
+
+        if(samples.dropped() != dropped)
+        {
+            dropped = samples.dropped();
+            printf("%lu samples dropped, core 0 fell behind\n", (unsigned long)dropped);
+        }
+
+        telemetry.poll();
+
+        if(!app.render()) sleep_ms(10);
     }
     return 0;
-}
\ No newline at end of file
+}